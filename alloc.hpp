@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <ostream>
+#pragma once
+
+// Heap traffic per frame, by the part of the game that caused it.
+//
+// Built with ALLOC_TRACKING defined (cmake -DALLOC_TRACKING=ON), this header replaces
+// the global operator new and delete of the program including it, which is fine as
+// every program here is one translation unit. Each allocation is counted against the
+// innermost Scope of its thread, or against other outside any; End_frame hands out the
+// counts since the last call. Without ALLOC_TRACKING nothing is replaced, Scope does
+// nothing and the counts stay zero.
+//
+// Over-aligned new (alignas above 16) keeps the library's own operators and is not
+// counted; nothing in the game allocates such types.
+
+namespace alloc {
+enum class Tag { other, simulation, collision, render, ui, count };
+
+constexpr int tag_count = static_cast<int>(Tag::count);
+
+const char *To_string(Tag tag);
+
+struct Counts
+{
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+};
+
+struct Frame
+{
+    Counts tags[tag_count];
+    std::uint64_t live_bytes = 0;      // at the end of the frame
+    std::uint64_t peak_live_bytes = 0; // during the frame
+
+    const Counts &operator[](Tag tag) const { return tags[static_cast<int>(tag)]; }
+    Counts Total() const;
+};
+
+#ifdef ALLOC_TRACKING
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+class Scope
+{
+public:
+    Scope(Tag tag);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    Tag outer;
+};
+
+void Record_allocation(std::size_t size);
+void Record_free(std::size_t size);
+Frame End_frame();
+
+class Summary
+// frames added one by one, for a report at the end of a session
+{
+public:
+    void Add(const Frame &frame);
+    void Write(std::ostream &output) const;
+
+    std::uint64_t Frame_count() const { return frames; }
+    const Counts &Total(Tag tag) const { return total[static_cast<int>(tag)]; }
+    const Counts &Worst_frame(Tag tag) const { return worst[static_cast<int>(tag)]; }
+    std::uint64_t Peak_live_bytes() const { return peak_live_bytes; }
+
+private:
+    std::uint64_t frames = 0;
+    Counts total[tag_count];
+    Counts worst[tag_count]; // the most allocations in one frame, and the most bytes
+    std::uint64_t peak_live_bytes = 0;
+};
+
+// atomics so the encoder, network and trace threads can allocate too; all constant
+// initialized, as allocations start before main
+struct Counters
+{
+    std::atomic<std::uint64_t> allocations[tag_count];
+    std::atomic<std::uint64_t> bytes[tag_count];
+    std::atomic<std::uint64_t> live_bytes;
+    std::atomic<std::uint64_t> peak_live_bytes;
+};
+
+inline Counters counters{};
+inline thread_local Tag current_tag = Tag::other;
+}; // namespace alloc
+
+const char *alloc::To_string(Tag tag)
+{
+    switch (tag) {
+    case Tag::simulation:
+        return "simulation";
+    case Tag::collision:
+        return "collision";
+    case Tag::render:
+        return "render";
+    case Tag::ui:
+        return "ui";
+    default:
+        return "other";
+    }
+}
+
+alloc::Counts alloc::Frame::Total() const
+{
+    Counts total;
+
+    for (const Counts &counts : tags) {
+        total.allocations += counts.allocations;
+        total.bytes += counts.bytes;
+    }
+
+    return total;
+}
+
+alloc::Scope::Scope(Tag tag)
+    : outer{current_tag}
+{
+    if (enabled)
+        current_tag = tag;
+}
+
+alloc::Scope::~Scope()
+{
+    if (enabled)
+        current_tag = outer;
+}
+
+void alloc::Record_allocation(std::size_t size)
+{
+    int tag = static_cast<int>(current_tag);
+
+    counters.allocations[tag].fetch_add(1, std::memory_order_relaxed);
+    counters.bytes[tag].fetch_add(size, std::memory_order_relaxed);
+
+    std::uint64_t live = counters.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    std::uint64_t peak = counters.peak_live_bytes.load(std::memory_order_relaxed);
+
+    while (live > peak
+           && !counters.peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        ;
+}
+
+void alloc::Record_free(std::size_t size)
+{
+    counters.live_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+alloc::Frame alloc::End_frame()
+// the counts since the last call, then the next frame starts from zero
+{
+    Frame frame;
+
+    for (int tag = 0; tag < tag_count; tag++) {
+        frame.tags[tag].allocations = counters.allocations[tag].exchange(0, std::memory_order_relaxed);
+        frame.tags[tag].bytes = counters.bytes[tag].exchange(0, std::memory_order_relaxed);
+    }
+
+    frame.live_bytes = counters.live_bytes.load(std::memory_order_relaxed);
+    frame.peak_live_bytes = std::max(
+        counters.peak_live_bytes.exchange(frame.live_bytes, std::memory_order_relaxed), frame.live_bytes);
+
+    return frame;
+}
+
+void alloc::Summary::Add(const Frame &frame)
+{
+    frames++;
+
+    for (int tag = 0; tag < tag_count; tag++) {
+        total[tag].allocations += frame.tags[tag].allocations;
+        total[tag].bytes += frame.tags[tag].bytes;
+        worst[tag].allocations = std::max(worst[tag].allocations, frame.tags[tag].allocations);
+        worst[tag].bytes = std::max(worst[tag].bytes, frame.tags[tag].bytes);
+    }
+
+    peak_live_bytes = std::max(peak_live_bytes, frame.peak_live_bytes);
+}
+
+void alloc::Summary::Write(std::ostream &output) const
+// "key value" lines like the script report, so budgets can be checked by a script
+{
+    output << "alloc_frames " << frames << '\n';
+
+    for (int tag = 0; tag < tag_count; tag++) {
+        const char *name = To_string(static_cast<Tag>(tag));
+        double mean_allocations = frames ? static_cast<double>(total[tag].allocations) / frames : 0;
+        double mean_bytes = frames ? static_cast<double>(total[tag].bytes) / frames : 0;
+
+        output << std::fixed << std::setprecision(3) << "alloc_" << name << "_per_frame "
+               << mean_allocations << '\n'
+               << "alloc_" << name << "_bytes_per_frame " << mean_bytes << '\n'
+               << "alloc_" << name << "_max_per_frame " << worst[tag].allocations << '\n'
+               << "alloc_" << name << "_max_bytes_per_frame " << worst[tag].bytes << '\n';
+    }
+
+    output << "alloc_peak_live_bytes " << peak_live_bytes << '\n';
+}
+
+#ifdef ALLOC_TRACKING
+// each block starts with its size, padded to keep the alignment new promises
+// kept out of line: inlined into a new or delete expression, gcc pairs it with the
+// library's operators and warns about a mismatched free
+#ifdef _MSC_VER
+#define ALLOC_NOINLINE __declspec(noinline)
+#else
+#define ALLOC_NOINLINE __attribute__((noinline))
+#endif
+
+namespace alloc {
+constexpr std::size_t header_size = alignof(std::max_align_t);
+
+ALLOC_NOINLINE void *Allocate(std::size_t size)
+{
+    void *block = std::malloc(size + header_size);
+
+    if (!block)
+        return nullptr;
+
+    *static_cast<std::size_t *>(block) = size;
+    Record_allocation(size);
+
+    return static_cast<char *>(block) + header_size;
+}
+
+ALLOC_NOINLINE void Free(void *pointer)
+{
+    if (!pointer)
+        return;
+
+    void *block = static_cast<char *>(pointer) - header_size;
+    Record_free(*static_cast<std::size_t *>(block));
+    std::free(block);
+}
+}; // namespace alloc
+
+void *operator new(std::size_t size)
+{
+    if (void *pointer = alloc::Allocate(size))
+        return pointer;
+
+    throw std::bad_alloc{};
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return alloc::Allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return alloc::Allocate(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    alloc::Free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    alloc::Free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    alloc::Free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+    alloc::Free(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept
+{
+    alloc::Free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept
+{
+    alloc::Free(pointer);
+}
+#endif
@@ -0,0 +1,574 @@
+#include "alloc.hpp"
+#include "character.hpp"
+#include "map.hpp"
+#include "map_generator.hpp"
+#include "match.hpp"
+#include "object.hpp"
+#include "option.hpp"
+#include "tween.hpp"
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+// benchmark [name ...]
+//     run the named benchmarks, or all of them when no name is given
+
+double Milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+Rectangle Arena_for(int obstacle_count)
+// an arena with room for obstacle_count obstacles, about 16 screens per thousand
+{
+    float scale = 4 * sqrtf(std::max(obstacle_count, 1000) / 1000.f);
+
+    return Rectangle(0, 0, param::window_width * scale, param::window_height * scale);
+}
+
+void Generator()
+// time to generate stress maps of growing size
+{
+    std::cout << std::setw(12) << "requested" << std::setw(12) << "placed" << std::setw(12)
+              << "ms" << std::setw(16) << "ns/obstacle\n";
+
+    for (int count : {1000, 4000, 16000, 64000}) {
+        auto start = std::chrono::steady_clock::now();
+        map_file::Map_data map_data = Map_generator(Arena_for(count), 1).Generate(count);
+        double elapsed = Milliseconds_since(start);
+
+        std::cout << std::setw(12) << count << std::setw(12) << map_data.Obstacle_count()
+                  << std::setw(12) << elapsed << std::setw(15)
+                  << elapsed * 1e6 / map_data.Obstacle_count() << '\n';
+    }
+}
+
+void Map_queries()
+// cost of the Map stop/kill helpers for one pawn sub-step on generated maps
+{
+    Fence fence;
+    Shot shot;
+
+    std::cout << std::setw(12) << "obstacles" << std::setw(16) << "ns/sub-step\n";
+
+    for (int count : {64, 1000, 4000, 16000}) {
+        Rectangle arena = Arena_for(count);
+        Loaded_map map = Loaded_map(fence, Map_generator(arena, 1).Generate(count));
+        Random random = Random(2);
+
+        const int steps = 20000;
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < steps; i++) {
+            if (i % param::translation_step == 0) {
+                Vector from = Vector(random.Uniform(0.f, arena.Width()),
+                                     random.Uniform(0.f, arena.Height()));
+                Vector to = Vector(random.Uniform(0.f, arena.Width()),
+                                   random.Uniform(0.f, arena.Height()));
+
+                shot.Start(from, to);
+            }
+
+            Pawn pawn = Pawn(Vector(random.Uniform(0.f, arena.Width()),
+                                    random.Uniform(0.f, arena.Height())),
+                             0);
+
+            pawn.Move(shot);
+            map.Wall_stop(pawn, shot);
+            map.Tree_stop(pawn, shot);
+            map.X_kill(pawn, shot);
+            map.Window_only_shoot(pawn, shot);
+            shot.Vanish_immediately(false);
+        }
+
+        std::cout << std::setw(12) << count << std::setw(15)
+                  << Milliseconds_since(start) * 1e6 / steps << '\n';
+    }
+}
+
+void Capsule_vs_decomposition()
+// swept circle against an X arm or a window: closed-form capsule test against the
+// old four part decomposition (two offset lines and two end circles)
+{
+    struct Scenario
+    {
+        Circle moving_circle;
+        Line segment;
+        Line velocity;
+    };
+
+    Random random = Random(3);
+    std::vector<Scenario> scenarios;
+    const int count = 1000000;
+    scenarios.reserve(count);
+
+    for (int i = 0; i < count; i++) {
+        Vector start = Vector(random.Uniform(0.f, 100.f), random.Uniform(0.f, 100.f));
+        Vector step = Vector(random.Uniform(-20.f, 20.f), random.Uniform(-20.f, 20.f));
+
+        // even scenarios are window-like (vertical), odd ones X-arm-like (diagonal)
+        float half_length = random.Uniform(5.f, 30.f);
+        Vector half = i % 2 == 0 ? Vector(0, half_length) : Vector(half_length, half_length);
+
+        scenarios.push_back({Circle(start, param::unit_length / 2),
+                             Line(Vector(50, 50) - half, Vector(50, 50) + half),
+                             Line(start, start + step)});
+    }
+
+    std::vector<float> reference(count);
+    std::vector<float> capsule(count);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < count; i++)
+        reference[i] = collision::Circle_vs_line(scenarios[i].moving_circle,
+                                                 scenarios[i].segment,
+                                                 scenarios[i].velocity);
+
+    double reference_ms = Milliseconds_since(start);
+    start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < count; i++)
+        capsule[i] = collision::Circle_vs_capsule(scenarios[i].moving_circle,
+                                                  Capsule(scenarios[i].segment),
+                                                  scenarios[i].velocity);
+
+    double capsule_ms = Milliseconds_since(start);
+
+    std::cout << "decomposition " << reference_ms * 1e6 / count << " ns/query\n"
+              << "capsule       " << capsule_ms * 1e6 / count << " ns/query\n";
+
+    // Only scenarios starting outside are compared: there the capsule reports 0 by
+    // design, the decomposition reports where the circle leaves one of its parts.
+    // The decomposition offsets its lines by Unit().Swap(), which is only a normal for
+    // axis aligned segments, so diagonal segments are expected to disagree.
+    for (int parity : {0, 1}) {
+        int outside = 0;
+        int disagreements = 0;
+        float max_difference = 0;
+
+        for (int i = parity; i < count; i += 2) {
+            if (collision::Circle_vs_capsule(scenarios[i].moving_circle,
+                                             Capsule(scenarios[i].segment),
+                                             Line(scenarios[i].velocity.Start(),
+                                                  scenarios[i].velocity.Start()))
+                == 0)
+                continue;
+
+            outside++;
+
+            if ((reference[i] == 2) != (capsule[i] == 2))
+                disagreements++;
+            else if (reference[i] != 2)
+                max_difference = std::max(max_difference, fabsf(reference[i] - capsule[i]));
+        }
+
+        std::cout << (parity == 0 ? "vertical: " : "diagonal: ") << outside
+                  << " starting outside, hit/miss disagreements: " << disagreements
+                  << ", max |t difference|: " << max_difference << '\n';
+    }
+}
+
+void Compound_early_out()
+// a tree-heavy map: every lobe tested, as Tree::Min_t used to, against the bounding
+// circle rejection of Circle_vs_compound
+{
+    Random random = Random(4);
+    std::vector<Compound<Circle, 6>> trees;
+
+    for (int i = 0; i < 1000; i++) {
+        Vector center = Vector(random.Uniform(0.f, 3200.f), random.Uniform(0.f, 2400.f));
+        std::array<Circle, 6> lobes{Circle(center, 10), Circle(center, 10), Circle(center, 10),
+                                    Circle(center, 10), Circle(center, 10), Circle(center, 10)};
+
+        for (int lobe = 0; lobe < 6; lobe++)
+            lobes[lobe].Translate(20 * cosf(lobe * param::pi / 3), 20 * sinf(lobe * param::pi / 3));
+
+        trees.emplace_back(lobes);
+    }
+
+    std::vector<Line> steps;
+
+    for (int i = 0; i < 2000; i++) {
+        Vector start = Vector(random.Uniform(0.f, 3200.f), random.Uniform(0.f, 2400.f));
+        steps.emplace_back(start, start + Vector(random.Uniform(-15.f, 15.f), random.Uniform(-15.f, 15.f)));
+    }
+
+    Circle pawn = Circle(0, 0, param::unit_length / 2);
+    float every_lobe_sum = 0;
+    float compound_sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (const Line &step : steps)
+        for (const auto &tree : trees) {
+            float t = 2;
+
+            for (const Circle &lobe : tree.Children())
+                t = std::min(t, collision::Circle_vs_circle(pawn, lobe, step));
+
+            every_lobe_sum += t;
+        }
+
+    double every_lobe_ms = Milliseconds_since(start);
+    start = std::chrono::steady_clock::now();
+
+    for (const Line &step : steps)
+        for (const auto &tree : trees)
+            compound_sum += collision::Circle_vs_compound(pawn, tree, step);
+
+    double compound_ms = Milliseconds_since(start);
+
+    std::cout << "every lobe " << every_lobe_ms * 1e6 / steps.size() << " ns/sub-step\n"
+              << "compound   " << compound_ms * 1e6 / steps.size() << " ns/sub-step\n"
+              << "sum of t, should match: " << every_lobe_sum << ", " << compound_sum << '\n';
+}
+
+void Kernels()
+// ns per call of the narrowphase kernels and of Vector::Unit on random input, then the
+// exact Vector paths against the approximate ones: a reciprocal multiply for operator/
+// and Rsqrt for Unit, faster but rounding differently
+{
+    Random random = Random(5);
+    const int count = 1000000;
+
+    std::vector<Line> steps;
+    std::vector<Vector> points;
+    steps.reserve(count);
+    points.reserve(count);
+
+    for (int i = 0; i < count; i++) {
+        Vector start = Vector(random.Uniform(0.f, 100.f), random.Uniform(0.f, 100.f));
+        steps.emplace_back(start, start + Vector(random.Uniform(-15.f, 15.f), random.Uniform(-15.f, 15.f)));
+        points.emplace_back(random.Uniform(-100.f, 100.f), random.Uniform(-100.f, 100.f));
+    }
+
+    Circle pawn = Circle(0, 0, param::unit_length / 2);
+    Circle circle = Circle(50, 50, 10);
+    Rectangle rectangle = Rectangle(40, 40, 20, 20);
+    Capsule capsule = Capsule(Vector(40, 40), Vector(60, 60));
+    Line segment = Line(40, 60, 60, 40);
+
+    auto run = [&](const char *name, auto kernel) {
+        float sum = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < count; i++)
+            sum += kernel(i);
+
+        std::cout << std::setw(24) << std::left << name << std::right << std::setw(10)
+                  << Milliseconds_since(start) * 1e6 / count << " ns  (sum " << sum << ")\n";
+    };
+
+    run("Circle_vs_circle", [&](int i) { return collision::Circle_vs_circle(pawn, circle, steps[i]); });
+    run("Circle_vs_rectangle",
+        [&](int i) { return collision::Circle_vs_rectangle(pawn, rectangle, steps[i]); });
+    run("Circle_inside_rectangle",
+        [&](int i) { return collision::Circle_inside_rectangle(pawn, rectangle, steps[i]); });
+    run("Circle_vs_capsule", [&](int i) { return collision::Circle_vs_capsule(pawn, capsule, steps[i]); });
+    run("Intersect(line, line)", [&](int i) { return collision::Intersect(steps[i], segment); });
+    run("Vector::Unit", [&](int i) { return points[i].Unit().X(); });
+
+    std::vector<float> divisors;
+    divisors.reserve(count);
+
+    for (int i = 0; i < count; i++)
+        divisors.push_back(random.Uniform(0.5f, 50.f));
+
+    std::cout << '\n'
+              << std::setw(24) << std::left << "" << std::right << std::setw(10) << "exact"
+              << std::setw(14) << "approximate" << "  (ns)  results that differ\n";
+
+    volatile float sink = 0; // so the timed loops are not optimized away
+
+    auto compare = [&](const char *name, auto exact, auto approximate) {
+        auto time = [&](auto kernel) {
+            float sum = 0;
+            auto start = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < count; i++)
+                sum += kernel(i).X();
+
+            sink = sum;
+            return Milliseconds_since(start) * 1e6 / count;
+        };
+
+        double exact_ns = time(exact);
+        double approximate_ns = time(approximate);
+        int differ = 0;
+        float worst = 0;
+
+        for (int i = 0; i < count; i++) {
+            Vector e = exact(i);
+            Vector a = approximate(i);
+
+            if (e == a)
+                continue;
+
+            differ++;
+            worst = std::max(worst, sqrtf((e - a).Magsq() / e.Magsq()));
+        }
+
+        std::cout << std::setw(24) << std::left << name << std::right << std::setw(10) << exact_ns
+                  << std::setw(14) << approximate_ns << "        " << differ << " of " << count
+                  << ", relative error up to " << worst << '\n';
+    };
+
+    compare(
+        "Vector / float",
+        [&](int i) { return points[i] / divisors[i]; },
+        [&](int i) { return points[i] * (1 / divisors[i]); });
+    compare(
+        "Vector::Unit",
+        [&](int i) { return points[i].Unit(); },
+        [&](int i) { return points[i] * Rsqrt(points[i].Magsq()); });
+}
+
+void Pawns()
+// bytes per pawn, and ns per pawn for Pawn::Kill and the visibility test of Game::Draw,
+// against the layout pawns had before: a full Circle and a color each, kills in a set
+// found by a scan of every enemy pawn (Kill now asks the Pawn_index)
+{
+    struct Wide_pawn
+    {
+        Circle shape;
+        ALLEGRO_COLOR color;
+    };
+
+    std::cout << "bytes per pawn: " << sizeof(Wide_pawn) << " before, " << sizeof(Pawn) << " now\n";
+    std::cout << std::setw(10) << "pawns" << std::setw(16) << "kill before" << std::setw(12) << "kill now"
+              << std::setw(16) << "cull before" << std::setw(12) << "cull now" << "  (ns/pawn)\n";
+
+    for (int count : {1000, 10000, 100000, 1000000}) {
+        Rectangle arena = Arena_for(count / 10);
+        Random random = Random(7);
+        std::vector<Wide_pawn> wide;
+        std::vector<Pawn> pawns;
+        wide.reserve(count);
+        pawns.reserve(count);
+
+        for (int i = 0; i < count; i++) {
+            Vector center = Vector(random.Uniform(0.f, arena.Width()), random.Uniform(0.f, arena.Height()));
+            wide.push_back({Circle(center, Pawn::radius), param::cyan});
+            pawns.emplace_back(center, 1);
+        }
+
+        const int sweeps = std::max(10, 10000000 / count);
+        std::vector<Shot> shots(sweeps);
+        std::vector<Pawn> movers;
+
+        for (int i = 0; i < sweeps; i++) {
+            Vector from = Vector(random.Uniform(0.f, arena.Width()), random.Uniform(0.f, arena.Height()));
+            float angle = random.Uniform(0.f, 2 * param::pi);
+            Vector to = from + Vector(cosf(angle), sinf(angle)) * param::reach_radius;
+
+            shots[i].Start(from, to);
+            movers.emplace_back(from, 0);
+            movers.back().Move(shots[i]);
+        }
+
+        std::set<Wide_pawn *> dying;
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < sweeps; i++) {
+            Circle mover = movers[i].Shape();
+            Line sweep = movers[i].Last_translation(shots[i]);
+
+            for (Wide_pawn &pawn : wide) {
+                if (collision::Circle_vs_circle(mover, pawn.shape, sweep) != 2)
+                    dying.insert(&pawn);
+            }
+        }
+
+        double kill_before = Milliseconds_since(start) * 1e6 / sweeps / count;
+        int killed = 0;
+        Pawn_index index = Pawn_index(arena, pawns);
+        index.Rebuild();
+        start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < sweeps; i++)
+            killed += movers[i].Kill(pawns, index, shots[i]);
+
+        double kill_now = Milliseconds_since(start) * 1e6 / sweeps / count;
+
+        // the view of a default camera somewhere in the arena
+        Rectangle view = Rectangle(arena.Width() / 3, arena.Height() / 3, param::window_width, param::window_height);
+        const int frames = std::max(10, 10000000 / count);
+        std::size_t visible_before = 0;
+        std::size_t visible_now = 0;
+        start = std::chrono::steady_clock::now();
+
+        for (int frame = 0; frame < frames; frame++) {
+            for (const Wide_pawn &pawn : wide) {
+                const Circle &shape = pawn.shape;
+                visible_before += (view.Closest_point_to(shape.Center()) - shape.Center()).Magsq()
+                                  <= shape.Radius() * shape.Radius();
+            }
+        }
+
+        double cull_before = Milliseconds_since(start) * 1e6 / frames / count;
+        start = std::chrono::steady_clock::now();
+
+        for (int frame = 0; frame < frames; frame++) {
+            for (const Pawn &pawn : pawns)
+                visible_now += pawn.Visible_in(view);
+        }
+
+        double cull_now = Milliseconds_since(start) * 1e6 / frames / count;
+
+        std::cout << std::setw(10) << count << std::setw(16) << kill_before << std::setw(12) << kill_now
+                  << std::setw(16) << cull_before << std::setw(12) << cull_now
+                  << (dying.size() == static_cast<std::size_t>(killed) && visible_before == visible_now
+                          ? ""
+                          : "  MISMATCH")
+                  << '\n';
+    }
+}
+
+void Teams()
+// us per simulated sub-step of a free for all played by random turns: every team's
+// pawns share one Pawn_index, so the cost follows the pawns near the shot, not the teams
+{
+    std::cout << std::setw(8) << "teams" << std::setw(12) << "turns" << std::setw(12) << "pawns"
+              << std::setw(16) << "us/sub-step" << '\n';
+
+    for (const char *teams : {"2", "4", "8", "16"}) {
+        char *arguments[] = {const_cast<char *>("benchmark"), const_cast<char *>("--teams"),
+                             const_cast<char *>(teams)};
+        Option option = Option(3, arguments);
+        Match match = Match(option);
+        Random random = Random(11);
+        const int turns = 4000;
+        long sub_steps = 0;
+        std::size_t pawn_total = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (int turn = 0; turn < turns; turn++) {
+            if (match.Over())
+                match.Reset();
+
+            match.Fire(Random_turn(match, random));
+
+            while (match.Shooting()) {
+                match.Step();
+                sub_steps++;
+            }
+
+            pawn_total += match.Pawns().size();
+        }
+
+        std::cout << std::setw(8) << teams << std::setw(12) << turns << std::setw(12)
+                  << pawn_total / turns << std::setw(16) << Milliseconds_since(start) * 1000 / sub_steps
+                  << "  (average pawns on the board)\n";
+    }
+}
+
+void Allocations()
+// heap traffic of random two team turns, each sub-step counted as a frame; needs a build
+// with ALLOC_TRACKING, which also counts the other sections' allocations, so time them apart
+{
+    if (!alloc::enabled) {
+        std::cout << "not counted, build with -DALLOC_TRACKING=ON\n";
+        return;
+    }
+
+    char *arguments[] = {const_cast<char *>("benchmark")};
+    Option option = Option(1, arguments);
+    Match match = Match(option);
+    Random random = Random(12);
+    alloc::Summary summary;
+
+    alloc::End_frame();
+
+    for (int turn = 0; turn < 2000; turn++) {
+        alloc::Scope tag{alloc::Tag::simulation};
+
+        if (match.Over())
+            match.Reset();
+
+        match.Fire(Random_turn(match, random));
+
+        while (match.Shooting()) {
+            match.Step();
+            summary.Add(alloc::End_frame());
+        }
+    }
+
+    std::cout << std::setw(12) << "tag" << std::setw(16) << "allocs/step" << std::setw(16)
+              << "bytes/step" << std::setw(16) << "max allocs" << '\n';
+
+    for (alloc::Tag tag : {alloc::Tag::simulation, alloc::Tag::collision, alloc::Tag::other}) {
+        const alloc::Counts &total = summary.Total(tag);
+
+        std::cout << std::setw(12) << alloc::To_string(tag) << std::setw(16)
+                  << static_cast<double>(total.allocations) / summary.Frame_count() << std::setw(16)
+                  << static_cast<double>(total.bytes) / summary.Frame_count() << std::setw(16)
+                  << summary.Worst_frame(tag).allocations << '\n';
+    }
+
+    std::cout << summary.Frame_count() << " sub-steps, peak live " << summary.Peak_live_bytes() / 1024
+              << " KiB\n";
+}
+
+void Tweens()
+// ns per running tween for one Animator::Update, fades of mixed lengths retiring as they go
+{
+    Random random = Random(6);
+
+    for (int count : {100, 1000, 10000, 100000}) {
+        tween::Animator animator;
+        const int frames = 600;
+        const float frame_seconds = 1 / 60.f;
+        double tween_updates = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (int frame = 0; frame < frames; frame++) {
+            // keep about count running, each lasting 0.1 to 1 s
+            while (animator.Size() < static_cast<std::size_t>(count))
+                animator.Start(param::magenta, param::vanish, random.Uniform(0.1f, 1.f));
+
+            tween_updates += animator.Size();
+            animator.Update(frame_seconds);
+        }
+
+        std::cout << std::setw(8) << count << " running  " << Milliseconds_since(start) * 1e6 / tween_updates
+                  << " ns per tween and frame, starts included\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::pair<std::string, std::function<void()>>> benchmarks{
+        {"generator", Generator},
+        {"map_queries", Map_queries},
+        {"capsule", Capsule_vs_decomposition},
+        {"compound", Compound_early_out},
+        {"kernels", Kernels},
+        {"pawns", Pawns},
+        {"teams", Teams},
+        {"tween", Tweens},
+        {"allocations", Allocations},
+    };
+
+    for (const auto &[name, run] : benchmarks) {
+        bool selected = argc == 1;
+
+        for (int i = 1; i < argc; i++)
+            selected = selected || name == argv[i];
+
+        if (!selected)
+            continue;
+
+        std::cout << "== " << name << '\n';
+        run();
+    }
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "geometry.hpp"
+#include "param.hpp"
+#include <algorithm>
+#include <allegro5/allegro5.h>
+#pragma once
+
+class Camera
+// maps the world onto the window; position is the world point at the window's top left
+{
+public:
+    Camera(const Vector &world_size, const Vector &view_size)
+        : world_size{world_size}
+        , view_size{view_size}
+        , position{(world_size - view_size) / 2}
+        , zoom{1}
+        , min_zoom{std::min(1.f,
+                            std::min(view_size.X() / world_size.X(),
+                                     view_size.Y() / world_size.Y()))}
+        , max_zoom{4}
+    {
+        Clamp();
+    }
+
+    void Pan(const Vector &screen_displacement)
+    {
+        position += screen_displacement / zoom;
+        Clamp();
+    }
+
+    void Zoom_at(const Vector &screen_point, float factor)
+    // keep the world point under screen_point in place
+    {
+        Vector anchor = Screen_to_world(screen_point);
+
+        zoom = std::clamp(zoom * factor, min_zoom, max_zoom);
+        position = anchor - screen_point / zoom;
+        Clamp();
+    }
+
+    Vector Screen_to_world(const Vector &screen_point) const { return position + screen_point / zoom; }
+
+    Rectangle View() const { return Rectangle(position, view_size / zoom); }
+
+    void Use() const
+    {
+        ALLEGRO_TRANSFORM transform;
+        al_identity_transform(&transform);
+        al_translate_transform(&transform, -position.X(), -position.Y());
+        al_scale_transform(&transform, zoom, zoom);
+        al_use_transform(&transform);
+    }
+
+    static void Use_screen()
+    {
+        ALLEGRO_TRANSFORM transform;
+        al_identity_transform(&transform);
+        al_use_transform(&transform);
+    }
+
+private:
+    void Clamp()
+    // center the world when it is smaller than the view, otherwise keep the view inside it
+    {
+        Vector visible = view_size / zoom;
+
+        if (visible.X() >= world_size.X())
+            position.X((world_size.X() - visible.X()) / 2);
+        else
+            position.X(std::clamp(position.X(), 0.f, world_size.X() - visible.X()));
+
+        if (visible.Y() >= world_size.Y())
+            position.Y((world_size.Y() - visible.Y()) / 2);
+        else
+            position.Y(std::clamp(position.Y(), 0.f, world_size.Y() - visible.Y()));
+    }
+
+    Vector world_size;
+    Vector view_size;
+    Vector position;
+    float zoom;
+    float min_zoom;
+    float max_zoom;
+};
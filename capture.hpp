@@ -0,0 +1,295 @@
+#include <allegro5/allegro5.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#pragma once
+
+// Lossless recording of every presented frame, for highlights.
+//
+// The game thread only reads the back buffer into a buffer of a fixed pool and queues
+// it; an encoder thread compresses it and writes it out, then hands the buffer back.
+// When every buffer is still queued, that frame is dropped and counted rather than
+// making the game wait on the disk or the encoder.
+//
+// The file is "MFGC", then per frame: the frame number (uint32), the byte count
+// (uint32) and a complete QOI image (qoiformat.org) of that many bytes, all little
+// endian. Gaps in the frame numbers are the dropped frames.
+
+namespace capture {
+struct Report
+{
+    std::uint32_t captured = 0; // read back and queued
+    std::uint32_t dropped = 0;  // no free buffer at the time
+    std::uint64_t raw_bytes = 0;
+    std::uint64_t written_bytes = 0;
+    double encode_ms = 0; // encoder thread, all frames
+};
+
+class Recorder
+{
+public:
+    Recorder(int width, int height, int buffer_count = 8)
+        : width{width}
+        , height{height}
+        , buffers(buffer_count,
+                  std::vector<std::uint8_t>(static_cast<std::size_t>(width) * height * 4))
+    {
+        for (int i = 0; i < buffer_count; i++)
+            free_buffers.push_back(i);
+    }
+
+    ~Recorder() { Stop(); }
+
+    Recorder(const Recorder &) = delete;
+    Recorder &operator=(const Recorder &) = delete;
+
+    bool Start(const std::string &path);
+    void Capture(ALLEGRO_DISPLAY *display, std::uint32_t frame);
+    Report Stop();
+
+private:
+    struct Frame
+    {
+        int buffer;
+        std::uint32_t number;
+    };
+
+    void Encode_frames();
+    static void Encode_qoi(const std::uint8_t *pixels,
+                           int width,
+                           int height,
+                           std::vector<std::uint8_t> &out);
+
+    const int width;
+    const int height;
+    std::vector<std::vector<std::uint8_t>> buffers; // RGBA, top row first
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<int> free_buffers;
+    std::deque<Frame> queued;
+    bool stopping = false;
+    Report report;
+
+    std::ofstream file;
+    std::thread encoder;
+};
+}; // namespace capture
+
+bool capture::Recorder::Start(const std::string &path)
+{
+    file.open(path, std::ios::binary);
+
+    if (!file)
+        return false;
+
+    file.write("MFGC", 4);
+    encoder = std::thread{[this] { Encode_frames(); }};
+
+    return true;
+}
+
+void capture::Recorder::Capture(ALLEGRO_DISPLAY *display, std::uint32_t frame)
+// after drawing and before the flip, the back buffer is the frame about to be shown
+{
+    int buffer;
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (!encoder.joinable() || stopping)
+            return;
+
+        if (free_buffers.empty()) {
+            report.dropped++;
+            return;
+        }
+
+        buffer = free_buffers.back();
+        free_buffers.pop_back();
+    }
+
+    ALLEGRO_BITMAP *back_buffer = al_get_backbuffer(display);
+    ALLEGRO_LOCKED_REGION *region
+        = al_lock_bitmap(back_buffer, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+
+    if (!region) {
+        std::lock_guard<std::mutex> lock{mutex};
+        free_buffers.push_back(buffer);
+        report.dropped++;
+        return;
+    }
+
+    // the pitch is negative where the driver stores the rows bottom up
+    const std::size_t row_bytes = static_cast<std::size_t>(width) * 4;
+    const std::size_t copied_bytes = static_cast<std::size_t>(std::min(width, al_get_bitmap_width(back_buffer))) * 4;
+    const int rows = std::min(height, al_get_bitmap_height(back_buffer));
+    const std::uint8_t *source = static_cast<const std::uint8_t *>(region->data);
+    std::uint8_t *pixels = buffers[buffer].data();
+
+    for (int y = 0; y < rows; y++)
+        std::memcpy(pixels + y * row_bytes,
+                    source + static_cast<std::ptrdiff_t>(y) * region->pitch,
+                    copied_bytes);
+
+    al_unlock_bitmap(back_buffer);
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        queued.push_back({buffer, frame});
+        report.captured++;
+    }
+
+    wake.notify_one();
+}
+
+capture::Report capture::Recorder::Stop()
+// writes what is queued, then closes the file
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+
+    wake.notify_one();
+
+    if (encoder.joinable())
+        encoder.join();
+
+    file.close();
+
+    std::lock_guard<std::mutex> lock{mutex};
+    return report;
+}
+
+void capture::Recorder::Encode_frames()
+{
+    std::vector<std::uint8_t> encoded;
+
+    while (true) {
+        Frame frame;
+
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            wake.wait(lock, [&] { return stopping || !queued.empty(); });
+
+            if (queued.empty())
+                return;
+
+            frame = queued.front();
+            queued.pop_front();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        Encode_qoi(buffers[frame.buffer].data(), width, height, encoded);
+
+        auto put_u32 = [&](std::uint32_t value) {
+            char bytes[4] = {static_cast<char>(value), static_cast<char>(value >> 8),
+                             static_cast<char>(value >> 16), static_cast<char>(value >> 24)};
+            file.write(bytes, 4);
+        };
+
+        put_u32(frame.number);
+        put_u32(static_cast<std::uint32_t>(encoded.size()));
+        file.write(reinterpret_cast<const char *>(encoded.data()), encoded.size());
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::lock_guard<std::mutex> lock{mutex};
+        free_buffers.push_back(frame.buffer);
+        report.raw_bytes += buffers[frame.buffer].size();
+        report.written_bytes += encoded.size() + 8;
+        report.encode_ms += elapsed.count();
+    }
+}
+
+void capture::Recorder::Encode_qoi(const std::uint8_t *pixels,
+                                   int width,
+                                   int height,
+                                   std::vector<std::uint8_t> &out)
+// the reference QOI encoder, into out, which keeps its capacity from frame to frame
+{
+    struct Pixel
+    {
+        std::uint8_t r, g, b, a;
+        bool operator==(const Pixel &other) const
+        {
+            return r == other.r && g == other.g && b == other.b && a == other.a;
+        }
+    };
+
+    auto put_u32_big_endian = [&](std::uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.push_back(static_cast<std::uint8_t>(value >> shift));
+    };
+
+    out.clear();
+    out.insert(out.end(), {'q', 'o', 'i', 'f'});
+    put_u32_big_endian(width);
+    put_u32_big_endian(height);
+    out.push_back(4); // channels
+    out.push_back(0); // sRGB with linear alpha
+
+    Pixel index[64] = {};
+    Pixel previous = {0, 0, 0, 255};
+    int run = 0;
+    const std::size_t count = static_cast<std::size_t>(width) * height;
+
+    for (std::size_t i = 0; i < count; i++) {
+        const std::uint8_t *p = pixels + i * 4;
+        Pixel pixel = {p[0], p[1], p[2], p[3]};
+
+        if (pixel == previous) {
+            if (++run == 62 || i + 1 == count) {
+                out.push_back(0xC0 | (run - 1)); // QOI_OP_RUN
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run > 0) {
+            out.push_back(0xC0 | (run - 1));
+            run = 0;
+        }
+
+        int hash = (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+
+        if (index[hash] == pixel) {
+            out.push_back(static_cast<std::uint8_t>(hash)); // QOI_OP_INDEX
+        } else {
+            index[hash] = pixel;
+
+            if (pixel.a == previous.a) {
+                signed char dr = pixel.r - previous.r;
+                signed char dg = pixel.g - previous.g;
+                signed char db = pixel.b - previous.b;
+                signed char dr_dg = dr - dg;
+                signed char db_dg = db - dg;
+
+                if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2) {
+                    out.push_back(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)); // QOI_OP_DIFF
+                } else if (dr_dg > -9 && dr_dg < 8 && dg > -33 && dg < 32 && db_dg > -9 && db_dg < 8) {
+                    out.push_back(0x80 | (dg + 32)); // QOI_OP_LUMA
+                    out.push_back((dr_dg + 8) << 4 | (db_dg + 8));
+                } else {
+                    out.insert(out.end(), {0xFE, pixel.r, pixel.g, pixel.b}); // QOI_OP_RGB
+                }
+            } else {
+                out.insert(out.end(), {0xFF, pixel.r, pixel.g, pixel.b, pixel.a}); // QOI_OP_RGBA
+            }
+        }
+
+        previous = pixel;
+    }
+
+    out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+}
@@ -1,9 +1,11 @@
 #include "collision.hpp"
 #include "geometry.hpp"
+#include "grid.hpp"
 #include "param.hpp"
 #include <allegro5/allegro_primitives.h>
 #include <allegro5/color.h>
-#include <set>
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #pragma once
 
@@ -21,6 +23,7 @@ public:
         , line_width{line_width}
         , life{param::life}
         , life_shapes{king_shape, king_shape, king_shape}
+        , decrease_life{false}
     {
         for (auto &life_shape : life_shapes) {
             life_shape.Scale(0.5);
@@ -52,13 +55,16 @@ public:
     const Circle &King_shape() const { return king_shape; }
     const Rectangle &Throne_shape() const { return throne_shape; }
     int Life() const { return life; }
+    const Circle &Life_shape(int index) const { return life_shapes[index]; }
     void Life_will_be_decreased() { decrease_life = true; }
     void Update_life()
     {
         if (!decrease_life)
             return;
 
-        life--;
+        if (life > 0) // a beaten king's throne still stands in free for all
+            life--;
+
         decrease_life = false;
     }
     void Reset_life() { life = param::life; }
@@ -89,140 +95,293 @@ private:
 class King_magenta : public King
 {
 public:
-    King_magenta()
-        : King{Circle(param::window_width - param::unit_length * 3.5,
-                      param::window_height / 2,
+    King_magenta(const Vector &world_size = Vector(param::window_width, param::window_height))
+        : King{Circle(world_size.X() - param::unit_length * 3.5,
+                      world_size.Y() / 2,
                       param::unit_length / 2),
-               Rectangle(param::window_width - param::unit_length * 5,
-                         param::window_height / 2 - param::unit_length * 1.5,
+               Rectangle(world_size.X() - param::unit_length * 5,
+                         world_size.Y() / 2 - param::unit_length * 1.5,
                          param::unit_length * 3,
                          param::unit_length * 3),
                param::magenta,
                param::line_width,
-               Vector(param::window_width - param::unit_length,
-                      param::window_height / 2 + param::unit_length * 1.5)} {};
+               Vector(world_size.X() - param::unit_length,
+                      world_size.Y() / 2 + param::unit_length * 1.5)} {};
 };
 
 class King_cyan : public King
 {
 public:
-    King_cyan()
-        : King{Circle(param::unit_length * 3.5, param::window_height / 2, param::unit_length / 2),
+    King_cyan(const Vector &world_size = Vector(param::window_width, param::window_height))
+        : King{Circle(param::unit_length * 3.5, world_size.Y() / 2, param::unit_length / 2),
                Rectangle(param::unit_length * 2,
-                         param::window_height / 2 - param::unit_length * 1.5,
+                         world_size.Y() / 2 - param::unit_length * 1.5,
                          param::unit_length * 3,
                          param::unit_length * 3),
                param::cyan,
                param::line_width,
-               Vector(param::unit_length, param::window_height / 2 + param::unit_length * 1.5)} {};
+               Vector(param::unit_length, world_size.Y() / 2 + param::unit_length * 1.5)} {};
 };
 
-class Pawn
+King Team_king(int team, int team_count, const Vector &world_size);
+
+class Shot
+// motion of the one pawn in flight, owned by its match so matches can run side by side
 {
 public:
-    Pawn(float cx, float cy, const ALLEGRO_COLOR &color)
-        : shape{cx, cy, param::unit_length / 2}
-        , color{color}
-    {}
-
-    Pawn(const Vector &center, const ALLEGRO_COLOR &color)
-        : shape{center, param::unit_length / 2}
-        , color{color}
-    {}
+    void Start(const Vector &start, const Vector &end)
+    {
+        translation = (end - start) / param::unit_length;
+        step_count = 0;
+    }
 
-    void Draw() const { shape.Draw(color); }
+    void Stop() { step_count = param::translation_step; }
 
-    bool Contain(const Vector &point) const { return shape.Contain(point); }
+    bool Finish_moving() const { return step_count == param::translation_step; }
 
-    static void Update_translation(const Vector &start, const Vector &end)
+    bool Advance()
+    // count one step, false when the shot had already finished
     {
-        translation = (end - start) / param::unit_length;
+        if (Finish_moving())
+            return false;
+
+        step_count++;
+        return true;
     }
 
-    static void Reset_translation_step_count() { translation_step_count = 0; }
+    const Vector &Translation() const { return translation; }
 
-    static void Stop() { translation_step_count = param::translation_step; }
+    void Vanish_immediately(bool value) { vanish_immediately = value; }
+    bool Vanish_immediately() const { return vanish_immediately; }
 
-    void Move()
-    {
-        if (translation_step_count == param::translation_step)
-            return;
+private:
+    unsigned int step_count = param::translation_step;
+    Vector translation = Vector(0, 0);
+    bool vanish_immediately = false;
+};
 
-        translation_step_count++;
+class Pawn_index;
 
-        shape.Translate(translation);
-    }
+class Pawn
+// twelve bytes: where it is, whose it is and whether it is dying; the radius and the
+// team colors are shared by every pawn
+{
+public:
+    static constexpr float radius = param::unit_length / 2;
+
+    Pawn(const Vector &center, int team)
+        : center{center}
+        , team{static_cast<std::uint8_t>(team)}
+        , dying{false}
+    {}
 
-    static bool Finish_moving() { return translation_step_count == param::translation_step; }
+    void Draw() const { al_draw_filled_circle(center.X(), center.Y(), radius, Color()); }
 
-    void Retreat(float compared_to_latest_translation)
+    bool Visible_in(const Rectangle &view) const
     {
-        shape.Translate(-compared_to_latest_translation * translation);
+        return (view.Closest_point_to(center) - center).Magsq() <= radius * radius;
     }
 
-    void Transform_color_to_vanish()
+    bool Contain(const Vector &point) const { return (point - center).Magsq() <= radius * radius; }
+
+    void Move(Shot &shot)
     {
-        Transform_color(color, param::vanish, param::color_transformation_ratio);
-    };
+        if (shot.Advance())
+            center += shot.Translation();
+    }
 
-    bool Color_equal_vanish()
+    void Retreat(float compared_to_latest_translation, const Shot &shot)
     {
-        if (Equal(color, param::vanish, 0.05f))
-            return true;
+        center += -compared_to_latest_translation * shot.Translation();
+    }
 
-        return false;
-    };
+    Line Last_translation(const Shot &shot) const
+    {
+        return Line(center - shot.Translation(), center);
+    }
 
-    Line Last_translation() const { return Line(shape.Center() - translation, shape.Center()); }
+    Circle Shape() const { return Circle(center, radius); }
 
-    const Circle &Shape() const { return shape; }
+    const Vector &Center() const { return center; }
 
-    Vector Center() const { return shape.Center(); }
+    int Team() const { return team; }
 
-    static void Vanish_immediately(bool value) { vanish_immediately = value; }
-    static bool Vanish_immediately() { return vanish_immediately; }
+    const ALLEGRO_COLOR &Color() const { return param::team_colors[team]; }
 
-    void Kill(std::vector<Pawn> &pawns, std::set<Pawn *> &dying_pawns) const
-    {
-        for (auto &pawn : pawns) {
-            if (collision::Circle_vs_circle(shape, pawn.Shape(), Last_translation()) == 2)
-                continue;
+    bool Dying() const { return dying; }
+    void Die() { dying = true; }
 
-            dying_pawns.insert(&pawn);
-        }
-    }
+    int Kill(std::vector<Pawn> &pawns, const Pawn_index &index, const Shot &shot) const;
 
-    void Hurt(King &king) const
+    void Hurt(King &king, Shot &shot) const
     {
-        float t = collision::Circle_vs_rectangle(shape, king.Throne_shape(), Last_translation());
+        float t = collision::Circle_vs_rectangle(Shape(), king.Throne_shape(), Last_translation(shot));
 
         if (t != 2)
-            Pawn::Vanish_immediately(true);
+            shot.Vanish_immediately(true);
 
-        t = collision::Circle_vs_circle(shape, king.King_shape(), Last_translation());
+        t = collision::Circle_vs_circle(Shape(), king.King_shape(), Last_translation(shot));
 
         if (t <= 1)
             king.Life_will_be_decreased();
     }
 
-    void Stopped_by(const King &king, const Vector &moving_pawn_spawn_position)
+    void Stopped_by(const King &king, const Vector &moving_pawn_spawn_position, Shot &shot)
     {
-        float t = collision::Circle_vs_rectangle(shape, king.Throne_shape(), Last_translation());
+        float t = collision::Circle_vs_rectangle(Shape(), king.Throne_shape(), Last_translation(shot));
 
         if (t == 2)
             return;
 
         if (!king.Contain(moving_pawn_spawn_position)) // when pawn doesn't come out of king
         {
-            Retreat(1 - t);
-            Stop();
+            Retreat(1 - t, shot);
+            shot.Stop();
         }
     }
 
 private:
-    inline static unsigned int translation_step_count = 0;
-    inline static Vector translation = Vector(0, 0);
-    inline static bool vanish_immediately = false;
-    Circle shape;
-    ALLEGRO_COLOR color;
+    Vector center;
+    std::uint8_t team; // index into param::team_colors
+    bool dying;
 };
+
+class Pawn_index
+// Uniform_grid of every team's pawns, ids are indices into pawns. Picking looks at one
+// cell, a shot asks for the pawns near its last translation whatever their team, so
+// its cost follows how crowded the place is rather than how many teams play.
+{
+public:
+    Pawn_index(const Rectangle &region, const std::vector<Pawn> &pawns)
+        : grid{region, param::unit_length * 4}
+        , pawns{pawns}
+        , last_bounds{0, 0, 0, 0}
+    {}
+
+    void Add_last()
+    {
+        last_bounds = Bounds(pawns.back());
+        grid.Insert(pawns.size() - 1, last_bounds);
+    }
+
+    void Remove_last()
+    // before popping the last pawn, wherever it has moved since it was indexed
+    {
+        grid.Remove(pawns.size() - 1, last_bounds);
+    }
+
+    void Update_last()
+    // the last pawn, the only one that moves, has stopped
+    {
+        Remove_last();
+        Add_last();
+    }
+
+    void Rebuild()
+    // after any pawn was erased, since erasing shifts the indices
+    {
+        grid.Clear();
+
+        for (std::size_t i = 0; i < pawns.size(); i++)
+            grid.Insert(i, Bounds(pawns[i]));
+
+        if (!pawns.empty())
+            last_bounds = Bounds(pawns.back());
+    }
+
+    const Pawn *Find(const Vector &point, int team) const
+    // only looks at the cell under point
+    {
+        const Pawn *found = nullptr;
+
+        grid.Query(point, [&](std::uint32_t id) {
+            if (pawns[id].Team() != team || !pawns[id].Contain(point))
+                return false;
+
+            found = &pawns[id];
+            return true;
+        });
+
+        return found;
+    }
+
+    template <typename Visit>
+    void Query(const Rectangle &bounds, Visit visit) const
+    // visit(id) for every pawn indexed in a cell that bounds overlaps
+    {
+        grid.Query(bounds, visit);
+    }
+
+private:
+    static Rectangle Bounds(const Pawn &pawn)
+    {
+        const float radius = Pawn::radius;
+
+        return Rectangle(pawn.Center() - Vector(radius, radius), Vector(radius, radius) * 2);
+    }
+
+    Uniform_grid grid;
+    const std::vector<Pawn> &pawns;
+    Rectangle last_bounds;
+};
+
+int Pawn::Kill(std::vector<Pawn> &pawns, const Pawn_index &index, const Shot &shot) const
+// marks the enemy pawns the last translation ran into, returns how many
+{
+    Line sweep = Last_translation(shot);
+    Circle shape = Shape();
+
+    // a hit needs a point of the sweep within two radii of the other center
+    const float reach = 2 * radius + param::unit_length / 8;
+    float left = std::min(sweep.Start().X(), sweep.End().X()) - reach;
+    float right = std::max(sweep.Start().X(), sweep.End().X()) + reach;
+    float top = std::min(sweep.Start().Y(), sweep.End().Y()) - reach;
+    float bottom = std::max(sweep.Start().Y(), sweep.End().Y()) + reach;
+    int killed = 0;
+
+    // indexed bounds are one radius around the centers, so one radius less is enough
+    Rectangle near = Rectangle(left + radius,
+                               top + radius,
+                               right - left - radius * 2,
+                               bottom - top - radius * 2);
+
+    index.Query(near, [&](std::uint32_t id) {
+        Pawn &pawn = pawns[id];
+        const Vector &other = pawn.center;
+
+        // & rather than ||, one well predicted branch instead of four random ones
+        if (!((other.X() >= left) & (other.X() <= right) & (other.Y() >= top)
+              & (other.Y() <= bottom))
+            || pawn.team == team || pawn.dying)
+            return;
+
+        if (collision::Circle_vs_circle(shape, pawn.Shape(), sweep) == 2)
+            return;
+
+        pawn.dying = true;
+        killed++;
+    });
+
+    return killed;
+}
+
+King Team_king(int team, int team_count, const Vector &world_size)
+// two teams face each other across the width, more are spread on an ellipse along the
+// fence, starting on the right and going clockwise
+{
+    if (team_count == 2)
+        return team == 0 ? King(King_magenta(world_size)) : King(King_cyan(world_size));
+
+    const float u = param::unit_length;
+    float angle = 2 * param::pi * team / team_count;
+    Vector outward = Vector(cosf(angle), sinf(angle));
+    Vector center = world_size / 2
+                    + Vector(outward.X() * (world_size.X() / 2 - u * 3.5f),
+                             outward.Y() * (world_size.Y() / 2 - u * 3.5f));
+
+    return King{Circle(center, u / 2),
+                Rectangle(center - Vector(u, u) * 1.5f, Vector(u, u) * 3),
+                param::team_colors[team],
+                param::line_width,
+                center + Vector(outward.X() >= 0 ? u * 2.5f : -u * 2.5f, u * 1.5f)};
+}
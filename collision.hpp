@@ -2,6 +2,7 @@
 // #include "character.hpp"
 #include "geometry.hpp"
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <set>
 #include <vector>
@@ -12,21 +13,43 @@ float Circle_vs_circle(const Circle &moving_circle,
                        const Circle &nonmoving_circle,
                        const Line &velocity);
 float Circle_vs_line(const Circle &moving_circle, const Line &nonmoving_line, const Line &velocity);
+float Circle_vs_capsule(const Circle &moving_circle,
+                        const Capsule &nonmoving_capsule,
+                        const Line &velocity);
 float Circle_vs_rectangle(const Circle &moving_circle,
                           const Rectangle &nonmoving_rectangle,
                           const Line &velocity);
 float Circle_inside_rectangle(const Circle &moving_circle,
                               const Rectangle &nonmoving_rectangle,
                               const Line &velocity);
+template <typename Primitive, std::size_t N>
+float Circle_vs_compound(const Circle &moving_circle,
+                         const Compound<Primitive, N> &nonmoving_compound,
+                         const Line &velocity);
 
 float Intersect(const Line &line1, const Line &line2);
 float Intersect(const Line &line, const Circle &circle);
+
+// narrowphase tests run by this thread, each Circle_vs_* call and each compound
+// bounding test counting one; the replay suite compares it across builds
+inline thread_local std::uint64_t test_count = 0;
+
+// those of the tests that found a contact, for the live telemetry
+inline thread_local std::uint64_t hit_count = 0;
+
+inline float Count_hit(float t)
+{
+    hit_count += t != 2;
+    return t;
+}
 }; // namespace collision
 
 float collision::Circle_vs_circle(const Circle &moving_circle,
                                   const Circle &nonmoving_circle,
                                   const Line &velocity)
 {
+    test_count++;
+
     Vector normal = velocity.Start() - nonmoving_circle.Center();
 
     if (normal.Magsq() <= 4 * moving_circle.Radius() * moving_circle.Radius()
@@ -36,13 +59,15 @@ float collision::Circle_vs_circle(const Circle &moving_circle,
     Circle circle = nonmoving_circle;
     circle.Add_radius_by(moving_circle.Radius());
 
-    return Intersect(velocity, circle);
+    return Count_hit(Intersect(velocity, circle));
 };
 
 float collision::Circle_vs_line(const Circle &moving_circle,
                                 const Line &nonmoving_line,
                                 const Line &velocity)
 {
+    test_count++;
+
     Line line_1 = nonmoving_line;
     Line line_2 = nonmoving_line;
     Circle start = moving_circle;
@@ -55,21 +80,119 @@ float collision::Circle_vs_line(const Circle &moving_circle,
     start.Center(nonmoving_line.Start());
     end.Center(nonmoving_line.End());
 
-    std::vector<float> ts;
-    ts.reserve(4);
+    return Count_hit(std::min({Intersect(velocity, line_1),
+                               Intersect(velocity, line_2),
+                               Intersect(velocity, start),
+                               Intersect(velocity, end)}));
+}
+
+float collision::Circle_vs_capsule(const Circle &moving_circle,
+                                   const Capsule &nonmoving_capsule,
+                                   const Line &velocity)
+// closed form time of impact of the swept circle: the moving center against the
+// capsule grown by the moving radius, first the side of the cylinder, then the caps
+// return 0 if the circle already touches the capsule
+// return 0 to 1 if they meet during velocity
+// return 2 otherwise
+{
+    test_count++;
+
+    float radius = nonmoving_capsule.Radius() + moving_circle.Radius();
+
+    Vector d = velocity.Direction();
+    Vector ab = nonmoving_capsule.End() - nonmoving_capsule.Start();
+    Vector ao = velocity.Start() - nonmoving_capsule.Start();
+
+    float dd = Vector::Dot(d, d);
+    float abab = Vector::Dot(ab, ab);
+    float abd = Vector::Dot(ab, d);
+    float abao = Vector::Dot(ab, ao);
+
+    // already inside
+    float s = abab > 0 ? std::clamp(abao / abab, 0.f, 1.f) : 0;
+
+    if ((ao - ab * s).Magsq() <= radius * radius)
+        return Count_hit(0);
+
+    if (dd == 0)
+        return 2;
+
+    // side of the cylinder: a t^2 + 2 b t + c = 0
+    float a = abab * dd - abd * abd;
+    float b = abab * Vector::Dot(d, ao) - abao * abd;
+    float c = abab * ao.Magsq() - abao * abao - radius * radius * abab;
+    float h = b * b - a * c;
+
+    if (h < 0)
+        return 2;
+
+    float along = abao;
+
+    if (a > 0) {
+        float t = (-b - sqrtf(h)) / a;
+        along = abao + t * abd;
+
+        if (along > 0 && along < abab)
+            return Count_hit(t >= 0 && t <= 1 ? t : 2);
+    }
+
+    // the cap on the side the cylinder was missed
+    Vector oc = along <= 0 ? ao : velocity.Start() - nonmoving_capsule.End();
 
-    ts.push_back(Intersect(velocity, line_1));
-    ts.push_back(Intersect(velocity, line_2));
-    ts.push_back(Intersect(velocity, start));
-    ts.push_back(Intersect(velocity, end));
+    b = Vector::Dot(d, oc);
+    c = oc.Magsq() - radius * radius;
+    h = b * b - dd * c;
 
-    return *std::min_element(ts.begin(), ts.end());
+    if (h < 0)
+        return 2;
+
+    float t = (-b - sqrtf(h)) / dd;
+
+    return Count_hit(t >= 0 && t <= 1 ? t : 2);
+}
+
+namespace collision {
+// child tests used by Circle_vs_compound
+float Circle_vs(const Circle &moving_circle, const Circle &nonmoving_circle, const Line &velocity)
+{
+    return Circle_vs_circle(moving_circle, nonmoving_circle, velocity);
+}
+
+float Circle_vs(const Circle &moving_circle, const Capsule &nonmoving_capsule, const Line &velocity)
+{
+    return Circle_vs_capsule(moving_circle, nonmoving_capsule, velocity);
+}
+}; // namespace collision
+
+template <typename Primitive, std::size_t N>
+float collision::Circle_vs_compound(const Circle &moving_circle,
+                                    const Compound<Primitive, N> &nonmoving_compound,
+                                    const Line &velocity)
+// the smallest t of the children, or 2 straight away when the swept circle stays
+// clear of the bounding circle
+{
+    test_count++;
+
+    const Circle &bounds = nonmoving_compound.Bounding_circle();
+    float reach = bounds.Radius() + moving_circle.Radius();
+
+    if ((velocity.Closest_point_to(bounds.Center()) - bounds.Center()).Magsq() > reach * reach)
+        return 2;
+
+    float t = 2;
+
+    for (const Primitive &child : nonmoving_compound.Children())
+        t = std::min(t, Circle_vs(moving_circle, child, velocity));
+
+    return Count_hit(t);
 }
 
 float collision::Circle_vs_rectangle(const Circle &moving_circle,
                                      const Rectangle &nonmoving_rectangle,
                                      const Line &velocity)
 {
+    test_count++;
+
     Vector rectangle_to_circle_past = velocity.Start()
                                       - nonmoving_rectangle.Closest_point_to(velocity.Start());
 
@@ -99,38 +222,31 @@ float collision::Circle_vs_rectangle(const Circle &moving_circle,
     bottom.Translate(Vector(0, moving_circle.Radius()));
     left.Translate(Vector(-moving_circle.Radius(), 0));
 
-    std::vector<float> ts;
-    ts.reserve(8);
-
-    ts.push_back(Intersect(velocity, top));
-    ts.push_back(Intersect(velocity, right));
-    ts.push_back(Intersect(velocity, bottom));
-    ts.push_back(Intersect(velocity, left));
-
-    ts.push_back(Intersect(velocity, top_left));
-    ts.push_back(Intersect(velocity, top_right));
-    ts.push_back(Intersect(velocity, bottom_right));
-    ts.push_back(Intersect(velocity, bottom_left));
+    return Count_hit(std::min({Intersect(velocity, top),
+                               Intersect(velocity, right),
+                               Intersect(velocity, bottom),
+                               Intersect(velocity, left),
 
-    return *std::min_element(ts.begin(), ts.end());
+                               Intersect(velocity, top_left),
+                               Intersect(velocity, top_right),
+                               Intersect(velocity, bottom_right),
+                               Intersect(velocity, bottom_left)}));
 };
 
 float collision::Circle_inside_rectangle(const Circle &moving_circle,
                                          const Rectangle &nonmoving_rectangle,
                                          const Line &velocity)
 {
+    test_count++;
+
     Rectangle rectangle = nonmoving_rectangle;
     rectangle.Translate(Vector(moving_circle.Radius(), moving_circle.Radius()));
     rectangle.Add_size_by(-2 * Vector(moving_circle.Radius(), moving_circle.Radius()));
 
-    std::vector<float> ts;
-
-    ts.push_back(Intersect(velocity, rectangle.Top()));
-    ts.push_back(Intersect(velocity, rectangle.Right()));
-    ts.push_back(Intersect(velocity, rectangle.Bottom()));
-    ts.push_back(Intersect(velocity, rectangle.Left()));
-
-    return *std::min_element(ts.begin(), ts.end());
+    return Count_hit(std::min({Intersect(velocity, rectangle.Top()),
+                               Intersect(velocity, rectangle.Right()),
+                               Intersect(velocity, rectangle.Bottom()),
+                               Intersect(velocity, rectangle.Left())}));
 }
 
 float collision::Intersect(const Line &line1, const Line &line2)
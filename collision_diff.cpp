@@ -0,0 +1,693 @@
+#include "character.hpp"
+#include "collision.hpp"
+#include "map.hpp"
+#include "map_generator.hpp"
+#include "object.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// collision_diff [--count scenarios] [--seed seed] [--epsilon e] [--threads count] [query ...]
+//     check every registered alternative implementation of a collision query against
+//     the reference, the scalar code the game runs, on seeded random scenarios spread
+//     over all cores: hit/miss disagreements and t apart by more than epsilon are
+//     counted, and the first one is shrunk to its simplest numbers that still disagree.
+//     Then each implementation is timed alone on the same scenarios. Queries without an
+//     alternative are only timed. Exits with 1 on any disagreement, except those of
+//     alternatives registered as expected to disagree, which are reported all the same.
+//
+// A new fast path is registered in Make_queries next to its reference, under a name
+// of its own, and has to come out of this clean before the game uses it.
+
+constexpr int max_parameters = 10;
+using Parameters = std::array<float, max_parameters>;
+
+struct Outcome
+{
+    float t;   // as the collision functions return it, or how far the pawn got for Map helpers
+    int flags; // Map helpers: 1 shot stopped, 2 pawn dying, 4 shot vanishing
+};
+
+enum class Disagreement { none, hit_miss, t };
+
+struct Implementation
+{
+    std::string name;
+    std::function<Outcome(const Parameters &)> run;
+    bool expected_to_disagree = false; // a known difference, left out of the exit status
+};
+
+struct Query
+{
+    std::string name;
+    std::vector<const char *> parameter_names;
+    std::function<void(Random &, Parameters &)> generate;
+    // called once per thread, as the Map helpers' grid is not thread safe; the first
+    // implementation is the reference
+    std::function<std::vector<Implementation>()> make_implementations;
+};
+
+struct Finding
+{
+    std::uint64_t hit_miss = 0;
+    std::uint64_t t_mismatch = 0;
+    float max_difference = 0;
+    std::uint64_t first = UINT64_MAX; // scenario number of the first disagreement
+    Parameters parameters{};
+};
+
+Disagreement Compare(const Outcome &reference, const Outcome &alternative, float epsilon)
+{
+    if ((reference.t == 2) != (alternative.t == 2) || reference.flags != alternative.flags)
+        return Disagreement::hit_miss;
+
+    if (std::isnan(reference.t) != std::isnan(alternative.t)
+        || fabsf(reference.t - alternative.t) > epsilon)
+        return Disagreement::t;
+
+    return Disagreement::none;
+}
+
+Outcome Hit(float t)
+{
+    return {t, 0};
+}
+
+Line Step(const Parameters &p)
+// the first four parameters of every query: where the moving center starts and its move
+{
+    return Line(Vector(p[0], p[1]), Vector(p[0] + p[2], p[1] + p[3]));
+}
+
+Circle Pawn_shape(const Parameters &p)
+{
+    return Circle(Vector(p[0], p[1]), Pawn::radius);
+}
+
+void Generate_step(Random &random, Parameters &p, float extent)
+{
+    p[0] = random.Uniform(0.f, extent);
+    p[1] = random.Uniform(0.f, extent);
+    p[2] = random.Uniform(-15.f, 15.f);
+    p[3] = random.Uniform(-15.f, 15.f);
+}
+
+Compound<Circle, 6> Tree_lobes(const Parameters &p)
+// as Tree lays them out: six lobes around the center, diameter p[6] overall
+{
+    Vector center = Vector(p[4], p[5]);
+    float radius = p[6] / 6;
+    std::array<Circle, 6> lobes{Circle(center, radius), Circle(center, radius), Circle(center, radius),
+                                Circle(center, radius), Circle(center, radius), Circle(center, radius)};
+
+    for (int lobe = 0; lobe < 6; lobe++)
+        lobes[lobe].Translate(2 * radius * cosf(lobe * param::pi / 3),
+                              2 * radius * sinf(lobe * param::pi / 3));
+
+    return Compound<Circle, 6>(lobes);
+}
+
+Compound<Capsule, 4> X_arms(const Parameters &p)
+// as X lays them out: four arms from the center, p[6] across
+{
+    Vector center = Vector(p[4], p[5]);
+    float size = p[6];
+
+    return Compound<Capsule, 4>(std::array<Capsule, 4>{Capsule(center, center + Vector(size, size) / 2),
+                                                       Capsule(center, center - Vector(size, size) / 2),
+                                                       Capsule(center, center + Vector(-size, size) / 2),
+                                                       Capsule(center, center + Vector(size, -size) / 2)});
+}
+
+template <typename Primitive, std::size_t N>
+float Every_child(const Circle &moving_circle, const Compound<Primitive, N> &compound, const Line &velocity)
+// the compound without its bounding circle rejection
+{
+    float t = 2;
+
+    for (const Primitive &child : compound.Children())
+        t = std::min(t, collision::Circle_vs(moving_circle, child, velocity));
+
+    return t;
+}
+
+class Map_fixture
+// a generated map and the pawn of one scenario, moved by one sub-step
+{
+public:
+    Map_fixture()
+        : fence{Vector(param::window_width, param::window_height) * 4}
+        , map{fence, Map_generator(fence.Shape(), 7).Generate(1000)}
+    {}
+
+    static void Generate(Random &random, Parameters &p)
+    {
+        Rectangle arena = Fence(Vector(param::window_width, param::window_height) * 4).Shape();
+
+        Generate_step(random, p, 1);
+        p[0] = arena.Origin().X() + p[0] * arena.Width();
+        p[1] = arena.Origin().Y() + p[1] * arena.Height();
+    }
+
+    template <typename Helper>
+    Outcome Run(const Parameters &p, Helper helper)
+    {
+        Shot shot;
+        Vector start = Vector(p[0], p[1]);
+        Vector move = Vector(p[2], p[3]);
+        Pawn pawn = Pawn(start, 0);
+
+        shot.Start(Vector(0, 0), move * param::unit_length);
+        pawn.Move(shot);
+        helper(pawn, shot);
+
+        float t = move.Magsq() > 0 ? Vector::Dot(pawn.Center() - start, move) / move.Magsq() : 0;
+
+        int flags = (shot.Finish_moving() ? 1 : 0) | (pawn.Dying() ? 2 : 0)
+                    | (shot.Vanish_immediately() ? 4 : 0);
+
+        return {t, flags};
+    }
+
+    static Rectangle Swept_bounds(const Pawn &pawn, const Shot &shot)
+    {
+        Line step = pawn.Last_translation(shot);
+        Vector low = Vector(std::min(step.Start().X(), step.End().X()),
+                            std::min(step.Start().Y(), step.End().Y()));
+        Vector high = Vector(std::max(step.Start().X(), step.End().X()),
+                             std::max(step.Start().Y(), step.End().Y()));
+        Vector margin = Vector(Pawn::radius, Pawn::radius);
+
+        return Rectangle(low - margin, high - low + margin * 2);
+    }
+
+    const Map &Get() const { return map; }
+
+private:
+    Fence fence;
+    Loaded_map map;
+};
+
+template <typename Obstacle, typename Visit>
+void Each_near(const Map &map, const Rectangle &bounds, Visit visit)
+// the obstacles of one kind a query of the grid finds, in the order the Map helpers use
+{
+    map.Query(bounds, [&](const auto &obstacle) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(obstacle)>, Obstacle>)
+            visit(obstacle);
+    });
+}
+
+std::vector<Query> Make_queries()
+{
+    std::vector<Query> queries;
+
+    auto kernel = [&](std::string name,
+                      std::vector<const char *> parameter_names,
+                      std::function<void(Random &, Parameters &)> generate,
+                      std::vector<Implementation> implementations) {
+        queries.push_back({name, parameter_names, generate, [=] { return implementations; }});
+    };
+
+    kernel("Circle_vs_circle", {"x", "y", "dx", "dy", "cx", "cy", "r"},
+           [](Random &random, Parameters &p) {
+               Generate_step(random, p, 100);
+               p[4] = random.Uniform(30.f, 70.f);
+               p[5] = random.Uniform(30.f, 70.f);
+               p[6] = random.Uniform(1.f, 20.f);
+           },
+           {{"reference", [](const Parameters &p) {
+                 Circle circle = Circle(Vector(p[4], p[5]), p[6]);
+                 return Hit(collision::Circle_vs_circle(Pawn_shape(p), circle, Step(p)));
+             }}});
+
+    kernel("Circle_vs_line", {"x", "y", "dx", "dy", "ax", "ay", "bx", "by"},
+           [](Random &random, Parameters &p) {
+               Generate_step(random, p, 100);
+
+               for (int i = 4; i < 8; i++)
+                   p[i] = random.Uniform(30.f, 70.f);
+           },
+           {{"reference", [](const Parameters &p) {
+                 Line line = Line(p[4], p[5], p[6], p[7]);
+                 return Hit(collision::Circle_vs_line(Pawn_shape(p), line, Step(p)));
+             }}});
+
+    kernel("Circle_vs_capsule", {"x", "y", "dx", "dy", "ax", "ay", "bx", "by", "r"},
+           [](Random &random, Parameters &p) {
+               Generate_step(random, p, 100);
+
+               for (int i = 4; i < 8; i++)
+                   p[i] = random.Uniform(30.f, 70.f);
+
+               p[8] = random.Uniform(0, 2) == 0 ? 0 : random.Uniform(0.f, 10.f);
+           },
+           {{"reference", [](const Parameters &p) {
+                 Capsule capsule = Capsule(Vector(p[4], p[5]), Vector(p[6], p[7]), p[8]);
+                 return Hit(collision::Circle_vs_capsule(Pawn_shape(p), capsule, Step(p)));
+             }}});
+
+    kernel("Circle_vs_rectangle", {"x", "y", "dx", "dy", "rx", "ry", "w", "h"},
+           [](Random &random, Parameters &p) {
+               Generate_step(random, p, 100);
+               p[4] = random.Uniform(20.f, 60.f);
+               p[5] = random.Uniform(20.f, 60.f);
+               p[6] = random.Uniform(1.f, 40.f);
+               p[7] = random.Uniform(1.f, 40.f);
+           },
+           {{"reference", [](const Parameters &p) {
+                 Rectangle rectangle = Rectangle(p[4], p[5], p[6], p[7]);
+                 return Hit(collision::Circle_vs_rectangle(Pawn_shape(p), rectangle, Step(p)));
+             }}});
+
+    kernel("Circle_inside_rectangle", {"x", "y", "dx", "dy", "rx", "ry", "w", "h"},
+           [](Random &random, Parameters &p) {
+               Generate_step(random, p, 100);
+               p[4] = random.Uniform(-20.f, 20.f);
+               p[5] = random.Uniform(-20.f, 20.f);
+               p[6] = random.Uniform(60.f, 140.f);
+               p[7] = random.Uniform(60.f, 140.f);
+           },
+           {{"reference", [](const Parameters &p) {
+                 Rectangle rectangle = Rectangle(p[4], p[5], p[6], p[7]);
+                 return Hit(collision::Circle_inside_rectangle(Pawn_shape(p), rectangle, Step(p)));
+             }}});
+
+    auto generate_obstacle = [](Random &random, Parameters &p) {
+        Generate_step(random, p, 100);
+        p[4] = random.Uniform(30.f, 70.f);
+        p[5] = random.Uniform(30.f, 70.f);
+        p[6] = random.Uniform(20.f, 80.f);
+    };
+
+    kernel("Circle_vs_compound(tree)", {"x", "y", "dx", "dy", "cx", "cy", "diameter"}, generate_obstacle,
+           {{"reference",
+             [](const Parameters &p) {
+                 return Hit(collision::Circle_vs_compound(Pawn_shape(p), Tree_lobes(p), Step(p)));
+             }},
+            {"every lobe", [](const Parameters &p) {
+                 return Hit(Every_child(Pawn_shape(p), Tree_lobes(p), Step(p)));
+             }}});
+
+    kernel("Circle_vs_compound(x)", {"x", "y", "dx", "dy", "cx", "cy", "size"}, generate_obstacle,
+           {{"reference",
+             [](const Parameters &p) {
+                 return Hit(collision::Circle_vs_compound(Pawn_shape(p), X_arms(p), Step(p)));
+             }},
+            {"every arm", [](const Parameters &p) {
+                 return Hit(Every_child(Pawn_shape(p), X_arms(p), Step(p)));
+             }}});
+
+    kernel("Intersect(line, line)", {"ax", "ay", "bx", "by", "cx", "cy", "dx", "dy"},
+           [](Random &random, Parameters &p) {
+               for (int i = 0; i < 8; i++)
+                   p[i] = random.Uniform(0.f, 100.f);
+           },
+           {{"reference", [](const Parameters &p) {
+                 Line line = Line(p[4], p[5], p[6], p[7]);
+                 return Hit(collision::Intersect(Line(p[0], p[1], p[2], p[3]), line));
+             }}});
+
+    kernel("Intersect(line, circle)", {"ax", "ay", "bx", "by", "cx", "cy", "r"},
+           [](Random &random, Parameters &p) {
+               for (int i = 0; i < 6; i++)
+                   p[i] = random.Uniform(0.f, 100.f);
+
+               p[6] = random.Uniform(1.f, 30.f);
+           },
+           {{"reference", [](const Parameters &p) {
+                 Circle circle = Circle(Vector(p[4], p[5]), p[6]);
+                 return Hit(collision::Intersect(Line(p[0], p[1], p[2], p[3]), circle));
+             }}});
+
+    // The Map helpers test every obstacle of their kind; the alternatives only test the
+    // ones a query of the map's grid around the swept pawn finds.
+    using Helper = void (*)(const Map &, Pawn &, Shot &);
+
+    auto map_helper = [&](std::string name,
+                          Helper reference,
+                          Helper alternative,
+                          bool expected_to_disagree = false) {
+        queries.push_back({name, {"x", "y", "dx", "dy"}, Map_fixture::Generate, [=] {
+                               auto fixture = std::make_shared<Map_fixture>();
+
+                               return std::vector<Implementation>{
+                                   {"reference",
+                                    [=](const Parameters &p) {
+                                        return fixture->Run(p, [&](Pawn &pawn, Shot &shot) {
+                                            reference(fixture->Get(), pawn, shot);
+                                        });
+                                    }},
+                                   {"grid query",
+                                    [=](const Parameters &p) {
+                                        return fixture->Run(p, [&](Pawn &pawn, Shot &shot) {
+                                            alternative(fixture->Get(), pawn, shot);
+                                        });
+                                    },
+                                    expected_to_disagree}};
+                           }});
+    };
+
+    map_helper(
+        "Map::Wall_stop",
+        [](const Map &map, Pawn &pawn, Shot &shot) { map.Wall_stop(pawn, shot); },
+        [](const Map &map, Pawn &pawn, Shot &shot) {
+            Each_near<Wall>(map, Map_fixture::Swept_bounds(pawn, shot), [&](const Wall &wall) {
+                float t = collision::Circle_vs_rectangle(pawn.Shape(),
+                                                         wall.Shape(),
+                                                         pawn.Last_translation(shot));
+
+                if (t == 2)
+                    return;
+
+                pawn.Retreat(1 - t, shot);
+                shot.Stop();
+            });
+        });
+
+    map_helper(
+        "Map::Tree_stop",
+        [](const Map &map, Pawn &pawn, Shot &shot) { map.Tree_stop(pawn, shot); },
+        [](const Map &map, Pawn &pawn, Shot &shot) {
+            Each_near<Tree>(map, Map_fixture::Swept_bounds(pawn, shot), [&](const Tree &tree) {
+                float t = tree.Min_t(pawn, shot);
+
+                if (t == 2)
+                    return;
+
+                pawn.Retreat(1 - t, shot);
+                shot.Stop();
+            });
+        });
+
+    // disagrees a few times per million scenarios, so the game keeps the reference;
+    // registered to track it, not as a candidate
+    map_helper(
+        "Map::X_kill",
+        [](const Map &map, Pawn &pawn, Shot &shot) { map.X_kill(pawn, shot); },
+        [](const Map &map, Pawn &pawn, Shot &shot) {
+            Each_near<X>(map, Map_fixture::Swept_bounds(pawn, shot), [&](const X &x) {
+                float t = x.Min_t(pawn, shot);
+
+                if (t == 2 || shot.Vanish_immediately())
+                    return;
+
+                pawn.Retreat(1 - t, shot);
+                shot.Stop();
+                pawn.Die();
+            });
+        },
+        true);
+
+    map_helper(
+        "Map::Window_only_shoot",
+        [](const Map &map, Pawn &pawn, Shot &shot) { map.Window_only_shoot(pawn, shot); },
+        [](const Map &map, Pawn &pawn, Shot &shot) {
+            Each_near<Window>(map, Map_fixture::Swept_bounds(pawn, shot), [&](const Window &window) {
+                float t = collision::Circle_vs_capsule(pawn.Shape(),
+                                                       window.Shape(),
+                                                       pawn.Last_translation(shot));
+
+                if (t != 2)
+                    shot.Vanish_immediately(true);
+            });
+        });
+
+    return queries;
+}
+
+int Decimals(float value)
+// how many decimals value needs, 7 for anything finer
+{
+    for (int decimals = 0; decimals < 7; decimals++) {
+        float scaled = value * powf(10, decimals);
+
+        if (scaled == roundf(scaled))
+            return decimals;
+    }
+
+    return 7;
+}
+
+bool Simpler(float candidate, float value)
+{
+    int candidate_decimals = Decimals(candidate);
+    int value_decimals = Decimals(value);
+
+    return candidate_decimals < value_decimals
+           || (candidate_decimals == value_decimals && fabsf(candidate) < fabsf(value));
+}
+
+Parameters Minimize(const Query &query,
+                    const Implementation &reference,
+                    const Implementation &alternative,
+                    Parameters p,
+                    float epsilon)
+// one parameter at a time, the simplest nearby number that keeps the same disagreement
+{
+    const Disagreement kind = Compare(reference.run(p), alternative.run(p), epsilon);
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        for (std::size_t i = 0; i < query.parameter_names.size(); i++) {
+            float value = p[i];
+            float candidates[] = {0,
+                                  truncf(value),
+                                  roundf(value),
+                                  roundf(value * 2) / 2,
+                                  roundf(value * 10) / 10,
+                                  roundf(value * 100) / 100,
+                                  roundf(value * 5) / 10};
+
+            for (float candidate : candidates) {
+                if (!Simpler(candidate, p[i]))
+                    continue;
+
+                Parameters trial = p;
+                trial[i] = candidate;
+
+                if (Compare(reference.run(trial), alternative.run(trial), epsilon) == kind) {
+                    p = trial;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    return p;
+}
+
+std::vector<Finding> Check(const Query &query,
+                           std::uint64_t count,
+                           std::uint64_t seed,
+                           float epsilon,
+                           int threads)
+// one Finding per alternative; scenarios come in chunks of their own seed, so they do
+// not depend on the thread count
+{
+    const std::uint64_t chunk_size = 1 << 16;
+    const std::uint64_t chunk_count = (count + chunk_size - 1) / chunk_size;
+    const std::size_t alternative_count = query.make_implementations().size() - 1;
+
+    std::atomic<std::uint64_t> next_chunk{0};
+    std::mutex mutex;
+    std::vector<Finding> findings(alternative_count);
+
+    auto work = [&] {
+        std::vector<Implementation> implementations = query.make_implementations();
+        std::vector<Finding> local(alternative_count);
+        Parameters p{};
+
+        for (std::uint64_t chunk; (chunk = next_chunk++) < chunk_count;) {
+            Random random = Random(seed + chunk * 0x9E3779B97F4A7C15ull);
+
+            for (std::uint64_t i = chunk * chunk_size; i < std::min(count, (chunk + 1) * chunk_size); i++) {
+                query.generate(random, p);
+                Outcome expected = implementations[0].run(p);
+
+                for (std::size_t a = 0; a < alternative_count; a++) {
+                    Outcome outcome = implementations[a + 1].run(p);
+                    Finding &finding = local[a];
+
+                    switch (Compare(expected, outcome, epsilon)) {
+                    case Disagreement::none:
+                        if (expected.t != 2)
+                            finding.max_difference
+                                = std::max(finding.max_difference, fabsf(expected.t - outcome.t));
+                        continue;
+                    case Disagreement::hit_miss:
+                        finding.hit_miss++;
+                        break;
+                    case Disagreement::t:
+                        finding.t_mismatch++;
+                        break;
+                    }
+
+                    if (i < finding.first) {
+                        finding.first = i;
+                        finding.parameters = p;
+                    }
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+
+        for (std::size_t a = 0; a < alternative_count; a++) {
+            findings[a].hit_miss += local[a].hit_miss;
+            findings[a].t_mismatch += local[a].t_mismatch;
+            findings[a].max_difference = std::max(findings[a].max_difference, local[a].max_difference);
+
+            if (local[a].first < findings[a].first) {
+                findings[a].first = local[a].first;
+                findings[a].parameters = local[a].parameters;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(work);
+
+    for (std::thread &worker : workers)
+        worker.join();
+
+    return findings;
+}
+
+volatile float sink; // what Time computes, so its loops are not optimized away
+
+std::vector<double> Time(const Query &query, std::uint64_t count, std::uint64_t seed)
+// ns per query of each implementation on one thread, over the same scenarios
+{
+    std::vector<Implementation> implementations = query.make_implementations();
+    std::vector<Parameters> scenarios(std::min<std::uint64_t>(count, 1000000));
+    Random random = Random(seed);
+
+    for (Parameters &p : scenarios)
+        query.generate(random, p);
+
+    std::vector<double> ns;
+
+    for (const Implementation &implementation : implementations) {
+        float sum = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (const Parameters &p : scenarios)
+            sum += implementation.run(p).t;
+
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        ns.push_back(elapsed.count() / scenarios.size());
+        sink = sum;
+    }
+
+    return ns;
+}
+
+void Print_case(const Implementation &implementation, const Parameters &p)
+{
+    Outcome outcome = implementation.run(p);
+
+    std::cout << "        " << std::setw(12) << std::left << implementation.name << std::right
+              << " t " << outcome.t;
+
+    if (outcome.flags != 0)
+        std::cout << ", flags " << outcome.flags;
+
+    std::cout << '\n';
+}
+
+int main(int argc, char **argv)
+{
+    std::uint64_t count = 2000000;
+    std::uint64_t seed = 1;
+    float epsilon = 1e-5f;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> selected;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (argument == "--count" && has_value)
+            count = std::stoull(argv[++i]);
+
+        else if (argument == "--seed" && has_value)
+            seed = std::stoull(argv[++i]);
+
+        else if (argument == "--epsilon" && has_value)
+            epsilon = std::stof(argv[++i]);
+
+        else if (argument == "--threads" && has_value)
+            threads = std::max(1, std::stoi(argv[++i]));
+
+        else
+            selected.push_back(argument);
+    }
+
+    int disagreeing = 0;
+
+    for (const Query &query : Make_queries()) {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), query.name) == selected.end())
+            continue;
+
+        std::vector<Implementation> implementations = query.make_implementations();
+        std::vector<Finding> findings = Check(query, count, seed, epsilon, threads);
+        std::vector<double> ns = Time(query, count, seed);
+
+        std::cout << "== " << query.name << ", " << count << " scenarios\n"
+                  << std::fixed << std::setprecision(2) << "    " << std::setw(12) << std::left
+                  << "reference" << std::right << std::setw(10) << ns[0] << " ns/query\n";
+
+        for (std::size_t a = 0; a < findings.size(); a++) {
+            const Finding &finding = findings[a];
+            const Implementation &alternative = implementations[a + 1];
+
+            std::cout << "    " << std::setw(12) << std::left << alternative.name << std::right
+                      << std::setw(10) << ns[a + 1] << " ns/query, " << ns[0] / ns[a + 1]
+                      << "x; hit/miss disagreements " << finding.hit_miss << ", t beyond "
+                      << std::defaultfloat << epsilon << ": " << finding.t_mismatch
+                      << ", max |t difference| agreeing " << finding.max_difference << std::fixed << '\n';
+
+            if (finding.first == UINT64_MAX)
+                continue;
+
+            if (alternative.expected_to_disagree)
+                std::cout << "      expected to disagree, not counted\n";
+            else
+                disagreeing++;
+
+            Parameters p = Minimize(query, implementations[0], alternative, finding.parameters, epsilon);
+
+            std::cout << std::defaultfloat << std::setprecision(9) << "      scenario " << finding.first
+                      << ", minimized:";
+
+            for (std::size_t i = 0; i < query.parameter_names.size(); i++)
+                std::cout << ' ' << query.parameter_names[i] << ' ' << p[i];
+
+            std::cout << '\n';
+            Print_case(implementations[0], p);
+            Print_case(alternative, p);
+            std::cout << std::fixed << std::setprecision(2);
+        }
+    }
+
+    if (disagreeing > 0)
+        std::cout << disagreeing << " alternative implementations disagree with the reference\n";
+
+    return disagreeing > 0 ? 1 : 0;
+}
@@ -1,86 +1,247 @@
 #include <allegro5/allegro5.h>
 // #include <allegro5/allegro_primitives.h>
 // #include <string>
+#include "alloc.hpp"
+#include "camera.hpp"
+#include "capture.hpp"
 #include "character.hpp"
 #include "object.hpp"
 #include <set>
 #include <vector>
 // #include "collision.hpp"
-#include "map.hpp"
+#include "lockstep.hpp"
+#include "match.hpp"
+#include "option.hpp"
+#include "script.hpp"
+#include "sequence.hpp"
+#include "spectator.hpp"
+#include "telemetry.hpp"
+#include "text.hpp"
+#include "trace.hpp"
+#include "tween.hpp"
 #include "ui.hpp"
+#include <chrono>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <optional>
 #pragma once
 
 enum class State { choose, aim, shoot, end };
 
+const char *To_string(State state)
+{
+    switch (state) {
+    case State::choose:
+        return "State::choose";
+    case State::aim:
+        return "State::aim";
+    case State::shoot:
+        return "State::shoot";
+    case State::end:
+        return "State::end";
+    }
+
+    return "State::unknown";
+}
+
+struct Startup_phase
+// part of what runs before the first frame
+{
+    const char *name;
+    double ms;
+    bool alongside; // on the loading thread, while the main thread went on
+};
+
+struct Ghost
+// something the match removed, drawn while it fades out
+{
+    Circle shape;
+    tween::Handle fade;
+};
+
 class Game
 {
 public:
-    Game();
+    Game(const Option &option);
     ~Game();
     void Run();
 
 private:
+    void Handle_event(const ALLEGRO_EVENT &event, bool &done, bool &redraw);
     void Draw() const;
+    void Draw_hud() const;
+    void Animate();
+    void Add_ghosts();
     void Update_aim_center(float x, float y);
     void Update_aim_direction(float x, float y);
+    void Pan_camera(int allegro_keyboard_event_keycode);
+    void Update_mouse_position();
+    End_dialog_box &End_dialog() const;
+    void Report_startup();
     void Add_pawn();
-    void Move_pawn();
-    void Clean_pawn();
-    void Play_again_or_quit(bool &done);
-
-    State state;
-    // Turn turn;
+    sequence::Task<> Play();
+    sequence::Task<std::optional<Turn>> Next_turn();
+    sequence::Task<std::optional<Turn>> Receive_turn();
+    sequence::Task<> Travel();
+    void Network_failure(const std::string &message);
+    bool Local_turn() const { return !peer || match->Active_side() == local_side; }
+    void Play_again_or_quit();
+    void Change_state(State new_state);
+    static std::unique_ptr<lockstep::Peer> Connect(const Option &option);
+    static std::unique_ptr<spectator::Server> Open_spectators(const Option &option);
+    static std::unique_ptr<capture::Recorder> Start_capture(const Option &option);
+    static std::unique_ptr<telemetry::Publisher> Open_telemetry(const Option &option);
+    void Publish_telemetry(const alloc::Frame &heap);
+    void Stop_capture();
+    static std::unique_ptr<script::Driver> Load_script(const Option &option);
+    void Write_script_report() const;
+
+    const std::chrono::steady_clock::time_point created; // startup is timed from here
+    std::vector<Startup_phase> startup;
+    double time_to_first_frame_ms;
+
+    State state; // what the input is for and what is drawn; Play moves it along
+
+    sequence::Scheduler scheduler;
+    sequence::Signal<Turn> turn_chosen; // by the local player
+    sequence::Signal<int> end_choice;   // the choice of the end dialog box
+    bool quitting;
 
     ALLEGRO_TIMER *timer;
     ALLEGRO_EVENT_QUEUE *queue;
     ALLEGRO_DISPLAY *display;
     ALLEGRO_FONT *font;
+    std::unique_ptr<text::Glyph_atlas> glyphs; // needs the display, so built after it
+    std::unique_ptr<text::Batch> hud;
 
-    Fence fence;
+    std::unique_ptr<Match> match; // built alongside the display, see Game::Game
+    Camera camera;
+    bool camera_dragged;
     Clipper clipper;
     Aim aim;
-    King_magenta king_magenta;
-    King_cyan king_cyan;
-    std::vector<Pawn> pawns_magenta;
-    std::vector<Pawn> pawns_cyan;
+    std::vector<Ghost> ghosts;
+    double last_frame_time;
 
-    King *active_king;
-    King *passive_king;
-    std::vector<Pawn> *active_pawns;
-    std::vector<Pawn> *passive_pawns;
-    std::set<Pawn *> vanishing_pawns;
+    bool mouse_moved;
+    Vector mouse_position;
 
-    End_dialog_box *pointer_to_end_dialog_box;
+    mutable std::unique_ptr<End_dialog_box> end_dialog_box; // built on first use
 
     // std::vector<Line> trail;
 
-    Map_1 map_1;
+    std::unique_ptr<lockstep::Peer> peer; // null in a local game
+    int local_side;                       // Match::Active_side value of this player
+    bool network_failed;
+
+    std::unique_ptr<spectator::Server> spectators; // null unless --spectators
+    std::uint32_t tick;
+
+    std::unique_ptr<capture::Recorder> recorder; // null unless --capture
+    std::uint32_t frame;
+    alloc::Summary allocations; // stays empty unless built with ALLOC_TRACKING
+
+    std::unique_ptr<telemetry::Publisher> monitor; // null unless --telemetry
+    telemetry::Sample sample;                      // the per tick counts are set by the timer
+    double last_flip_time;
+    double rate_start_time; // of the window ticks_per_second is measured over
+    std::uint32_t rate_start_tick;
+
+    std::unique_ptr<script::Driver> driver; // null unless --script
+    std::string script_report_path;
 };
 
-Game::Game()
-    : state{State::choose}
-    , active_king{&king_magenta}
-    , passive_king{&king_cyan}
-    , active_pawns{&pawns_magenta}
-    , passive_pawns{&pawns_cyan}
-    , map_1{fence}
+Game::Game(const Option &option)
+    : created{std::chrono::steady_clock::now()}
+    , time_to_first_frame_ms{0}
+    , state{State::choose}
+    , turn_chosen{scheduler}
+    , end_choice{scheduler}
+    , quitting{false}
+    , camera{Match::Arena_size(option), Vector(param::window_width, param::window_height)}
+    , camera_dragged{false}
+    , clipper{Match::Arena_size(option)}
+    , last_frame_time{0}
+    , mouse_moved{false}
+    , mouse_position{0, 0}
+    , local_side{option.Host_port() != 0 ? 0 : 1}
+    , network_failed{false}
+    , spectators{Open_spectators(option)}
+    , tick{0}
+    , frame{0}
+    , monitor{Open_telemetry(option)}
+    , sample{}
+    , last_flip_time{0}
+    , rate_start_time{0}
+    , rate_start_tick{0}
+    , script_report_path{option.Script_report_path()}
+// the match, with its map and the map's grid, needs nothing of allegro, so it is built
+// on a loading thread while allegro and the display come up
 {
+    std::future<std::pair<std::unique_ptr<Match>, double>> loading = std::async(
+        std::launch::async, [&option] {
+            trace::Scope scope{"Build_match", "startup"};
+            auto start = std::chrono::steady_clock::now();
+            auto built = std::make_unique<Match>(option);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now()
+                                                                - start;
+
+            return std::make_pair(std::move(built), elapsed.count());
+        });
+
+    auto phase_start = created;
+
+    auto end_phase = [&](const char *name) {
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::milli> elapsed = now - phase_start;
+        startup.push_back({name, elapsed.count(), false});
+        phase_start = now;
+        trace::Instant(name, "startup");
+    };
+
+    end_phase("spectators_and_telemetry");
+
+    if (option.Networked()) {
+        peer = Connect(option);
+        end_phase("connect");
+    }
+
     al_init();
     al_init_primitives_addon();
     al_install_keyboard();
     al_install_mouse();
+    end_phase("allegro");
 
     timer = al_create_timer(1.0 / 30.0);
     queue = al_create_event_queue();
     display = al_create_display(param::window_width, param::window_height);
+    end_phase("display");
+
     font = al_create_builtin_font();
+    glyphs = std::make_unique<text::Glyph_atlas>(font);
+    hud = std::make_unique<text::Batch>(*glyphs);
+    end_phase("font");
+
+    recorder = Start_capture(option);
+    driver = Load_script(option);
+    end_phase("capture_and_script");
+
+    auto [built, match_ms] = loading.get();
+    match = std::move(built);
+    end_phase("wait_for_match");
+    startup.push_back({"match", match_ms, true});
 
     // al_set_window_position(display_, 0, 0);
 }
 
 Game::~Game()
 {
+    Stop_capture();
+    driver.reset();
+    end_dialog_box.reset();
+    hud.reset();
+    glyphs.reset();
     al_destroy_font(font);
     al_destroy_display(display);
     al_destroy_timer(timer);
@@ -89,243 +250,664 @@ Game::~Game()
 
 void Game::Draw() const
 {
+    Rectangle view = camera.View();
+
     al_clear_to_color(param::black);
 
+    camera.Use();
+
     aim.Draw();
-    king_cyan.Draw();
-    king_magenta.Draw();
+
+    for (const King &king : match->Kings())
+        king.Draw();
 
     clipper.Draw();
-    map_1.Draw();
-    king_cyan.Draw_life();
-    king_magenta.Draw_life();
+    match->Obstacles().Draw(view);
 
-    for (const auto &pawn_magenta : pawns_magenta) {
-        pawn_magenta.Draw();
-    }
+    for (const King &king : match->Kings())
+        king.Draw_life();
 
-    for (const auto &pawn_cyan : pawns_cyan) {
-        pawn_cyan.Draw();
-    }
+    // only the pawns indexed in cells the view overlaps, however many the world holds;
+    // the shot pawn has left its cells, it is drawn on its own, on top as before
+    const std::vector<Pawn> &pawns = match->Pawns();
+    const Pawn *shot_pawn = match->Shot_pawn();
+
+    match->Index().Query(view, [&](std::uint32_t id) {
+        if (&pawns[id] != shot_pawn && pawns[id].Visible_in(view))
+            pawns[id].Draw();
+    });
+
+    if (shot_pawn && shot_pawn->Visible_in(view))
+        shot_pawn->Draw();
     
-    fence.Draw();
+    for (const Ghost &ghost : ghosts)
+        ghost.shape.Draw(tween::Animator::Instance().Color(ghost.fade, param::vanish));
+
+    match->Boundary().Draw();
 
+    Camera::Use_screen();
+    alloc::Scope tag{alloc::Tag::ui};
+    Draw_hud();
+
+    if (state == State::end)
+        End_dialog().Draw();
+}
+
+void Game::Draw_hud() const
+// whose turn it is, which a free for all of many colors needs spelled out
+{
     if (state == State::end)
-        pointer_to_end_dialog_box->Draw();
+        return;
+
+    Vector origin = Vector(param::unit_length / 2, param::unit_length / 2);
+
+    origin += Vector(
+        hud->Add(origin, param::team_names[match->Active_side()], match->Active_king().Color()), 0);
+    origin += Vector(hud->Add(origin, " to play, turn ", param::white), 0);
+    hud->Add(origin, match->Turn_count() + 1.0, 0, param::white);
+    hud->Draw();
+}
+
+void Game::Animate()
+// by the time since the last frame, so fades keep their length whatever the frame rate
+{
+    trace::Scope scope{"Animate", "run"};
+
+    double now = al_get_time();
+    tween::Animator &animator = tween::Animator::Instance();
+
+    animator.Update(static_cast<float>(now - last_frame_time));
+    last_frame_time = now;
+
+    ghosts.erase(std::remove_if(ghosts.begin(),
+                                ghosts.end(),
+                                [&](const Ghost &ghost) { return !animator.Running(ghost.fade); }),
+                 ghosts.end());
+}
+
+void Game::Add_ghosts()
+{
+    for (const Vanished &vanished : match->Vanished_in_last_step()) {
+        float seconds = vanished.life ? param::life_loss_seconds : param::vanish_seconds;
+
+        ghosts.push_back({vanished.shape,
+                          tween::Animator::Instance().Start(vanished.color, param::vanish, seconds)});
+    }
 }
 
 void Game::Run()
 {
-    al_register_event_source(queue, al_get_keyboard_event_source());
     al_register_event_source(queue, al_get_display_event_source(display));
-    al_register_event_source(queue, al_get_timer_event_source(timer));
-    al_register_event_source(queue, al_get_mouse_event_source());
+
+    // a script stands in for the devices and the timer, so a stray mouse move or a
+    // slow frame cannot change what the session does
+    if (driver) {
+        driver->Register(queue);
+    } else {
+        al_register_event_source(queue, al_get_keyboard_event_source());
+        al_register_event_source(queue, al_get_timer_event_source(timer));
+        al_register_event_source(queue, al_get_mouse_event_source());
+    }
 
     bool done = false;
     bool redraw = true;
     ALLEGRO_EVENT event;
 
-    End_dialog_box end_dialog_box = End_dialog_box(font);
-    pointer_to_end_dialog_box = &end_dialog_box;
+    if (!driver)
+        al_start_timer(timer);
+
+    last_frame_time = al_get_time();
+    last_flip_time = last_frame_time;
+    rate_start_time = last_frame_time;
+    scheduler.Start(Play());
 
-    al_start_timer(timer);
+    // loading is not the first frame's doing
+    alloc::End_frame();
 
     while (true) {
+        if (driver && al_is_event_queue_empty(queue))
+            driver->Emit_frame();
+
+        trace::Begin("Wait_for_event", "run");
         al_wait_for_event(queue, &event);
+        trace::End("Wait_for_event", "run");
 
-        switch (event.type) {
-        case ALLEGRO_EVENT_TIMER:
-            if (state == State::shoot) {
-                Move_pawn();
-                Clean_pawn();
-            }
-            redraw = true;
+        if (driver) {
+            auto start = std::chrono::steady_clock::now();
+            Handle_event(event, done, redraw);
+            driver->Count_event(
+                std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        } else {
+            Handle_event(event, done, redraw);
+        }
+
+        // the sequences the event resumed run before the next one is handled
+        scheduler.Run_ready();
+
+        if (done || quitting)
             break;
 
-        case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN:
+        if (mouse_moved && al_is_event_queue_empty(queue))
+            Update_mouse_position();
+
+        if (redraw && al_is_event_queue_empty(queue)) {
+            Animate();
 
-            if (event.mouse.button == 1 && state == State::aim)
-                Add_pawn();
+            {
+                trace::Scope scope{"Draw", "run"};
+                alloc::Scope tag{alloc::Tag::render};
+                Draw();
+            }
 
-            else if (event.mouse.button == 1 && state == State::end)
-                Play_again_or_quit(done);
+            if (recorder) {
+                trace::Scope scope{"Capture", "run"};
+                recorder->Capture(display, frame);
+            }
 
-            break;
+            trace::Begin("Flip_display", "run");
+            al_flip_display();
+            trace::End("Flip_display", "run");
 
-        case ALLEGRO_EVENT_MOUSE_AXES:
+            if (frame == 0)
+                Report_startup();
 
-            if (state == State::choose)
-                Update_aim_center(event.mouse.x, event.mouse.y);
+            frame++;
 
-            else if (state == State::aim)
-                Update_aim_direction(event.mouse.x, event.mouse.y);
+            alloc::Frame heap;
 
-            else if (state == State::end)
-                pointer_to_end_dialog_box->Update_selected_choice(
-                    Vector(event.mouse.x, event.mouse.y));
+            if (alloc::enabled) {
+                heap = alloc::End_frame();
+                allocations.Add(heap);
+            }
 
-            break;
+            if (monitor)
+                Publish_telemetry(heap);
 
-        case ALLEGRO_EVENT_KEY_CHAR:
-            if (state == State::end)
-                pointer_to_end_dialog_box->Update_selected_choice(event.keyboard.keycode);
+            if (driver)
+                driver->Count_frame();
 
-            if (state == State::end && event.keyboard.keycode == ALLEGRO_KEY_ENTER)
-                Play_again_or_quit(done);
+            redraw = false;
+        }
+    }
 
-            if (event.keyboard.keycode != ALLEGRO_KEY_ESCAPE)
-                break;
+    if (driver)
+        Write_script_report();
 
-        case ALLEGRO_EVENT_DISPLAY_CLOSE:
-            done = true;
-            break;
+    else if (alloc::enabled)
+        allocations.Write(std::clog);
+}
+
+void Game::Handle_event(const ALLEGRO_EVENT &event, bool &done, bool &redraw)
+// one event of the queue, from the devices, the timer or a script
+{
+    switch (event.type) {
+    case ALLEGRO_EVENT_TIMER: {
+        std::uint64_t tests = collision::test_count;
+        std::uint64_t hits = collision::hit_count;
+
+        scheduler.Tick();
+
+        sample.collision_tests = collision::test_count - tests;
+        sample.collision_hits = collision::hit_count - hits;
+
+        if (spectators) {
+            trace::Scope scope{"Publish", "spectator"};
+            spectators->Publish(
+                spectator::Capture(*match, tick, static_cast<std::uint32_t>(state), aim));
         }
 
-        if (done)
+        tick++;
+        redraw = true;
+        break;
+    }
+
+    case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN:
+        Update_mouse_position();
+
+        if (event.mouse.button == 1 && state == State::aim)
+            Add_pawn();
+
+        else if (event.mouse.button == 1 && state == State::end)
+            Play_again_or_quit();
+
+        else if (event.mouse.button == 2)
+            camera_dragged = true;
+
+        break;
+
+    case ALLEGRO_EVENT_MOUSE_BUTTON_UP:
+
+        if (event.mouse.button == 2)
+            camera_dragged = false;
+
+        break;
+
+    case ALLEGRO_EVENT_MOUSE_AXES:
+
+        if (event.mouse.dz != 0 && state != State::end)
+            camera.Zoom_at(Vector(event.mouse.x, event.mouse.y), powf(1.25f, event.mouse.dz));
+
+        if (camera_dragged && state != State::end)
+            camera.Pan(-Vector(event.mouse.dx, event.mouse.dy));
+
+        // picking waits until the queue is drained, so a burst of moves costs one pick
+        mouse_moved = true;
+        mouse_position = Vector(event.mouse.x, event.mouse.y);
+
+        break;
+
+    case ALLEGRO_EVENT_KEY_CHAR:
+        Update_mouse_position();
+
+        if (state != State::end)
+            Pan_camera(event.keyboard.keycode);
+
+        if (state == State::end)
+            End_dialog().Update_selected_choice(event.keyboard.keycode);
+
+        if (state == State::end && event.keyboard.keycode == ALLEGRO_KEY_ENTER)
+            Play_again_or_quit();
+
+        if (event.keyboard.keycode != ALLEGRO_KEY_ESCAPE)
             break;
 
-        if (redraw && al_is_event_queue_empty(queue)) {
-            Draw();
-            al_flip_display();
-            redraw = false;
-        }
+    case ALLEGRO_EVENT_DISPLAY_CLOSE:
+        done = true;
+        break;
     }
 }
 
+void Game::Update_mouse_position()
+{
+    if (!mouse_moved)
+        return;
+
+    mouse_moved = false;
+
+    if (state == State::choose && Local_turn())
+        Update_aim_center(mouse_position.X(), mouse_position.Y());
+
+    else if (state == State::aim)
+        Update_aim_direction(mouse_position.X(), mouse_position.Y());
+
+    else if (state == State::end)
+        End_dialog().Update_selected_choice(mouse_position);
+}
+
+End_dialog_box &Game::End_dialog() const
+// laid out when a match first ends, nothing needs it before
+{
+    if (!end_dialog_box)
+        end_dialog_box = std::make_unique<End_dialog_box>(font);
+
+    return *end_dialog_box;
+}
+
+void Game::Report_startup()
+// once the first frame is shown
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - created;
+    time_to_first_frame_ms = elapsed.count();
+    trace::Instant("First_frame", "startup");
+
+    std::clog << "first frame after " << time_to_first_frame_ms << " ms\n";
+
+    for (const Startup_phase &phase : startup)
+        std::clog << "    " << phase.name << ' ' << phase.ms << " ms"
+                  << (phase.alongside ? ", on the loading thread" : "") << '\n';
+}
+
 void Game::Update_aim_center(float x, float y)
 {
-    Vector mouse_coordinate = Vector(x, y);
+    Vector mouse_coordinate = camera.Screen_to_world(Vector(x, y));
 
-    if (active_king->Contain(mouse_coordinate)) {
-        aim.Center(active_king->Center());
+    if (match->Active_king().Contain(mouse_coordinate)) {
+        aim.Center(match->Active_king().Center());
         aim.Show_reach_circle();
-        state = State::aim;
-    } else {
-        for (const auto &pawn : *active_pawns) {
-            if (pawn.Contain(mouse_coordinate)) {
-                aim.Center(pawn.Center());
-                aim.Show_reach_circle();
-                state = State::aim;
-            }
-        }
+        Change_state(State::aim);
+    } else if (const Pawn *pawn = match->Index().Find(mouse_coordinate, match->Active_side())) {
+        aim.Center(pawn->Center());
+        aim.Show_reach_circle();
+        Change_state(State::aim);
     }
 }
 
 void Game::Update_aim_direction(float x, float y)
 {
-    Vector mouse_coordinate = Vector(x, y);
+    Vector mouse_coordinate = camera.Screen_to_world(Vector(x, y));
 
-    if (active_king->Contain(mouse_coordinate))
-        aim.Center(active_king->Center());
+    if (match->Active_king().Contain(mouse_coordinate))
+        aim.Center(match->Active_king().Center());
 
-    else
-        for (const auto &pawn : *active_pawns)
-            if (pawn.Contain(mouse_coordinate))
-                aim.Center(pawn.Center());
+    else if (const Pawn *pawn = match->Index().Find(mouse_coordinate, match->Active_side()))
+        aim.Center(pawn->Center());
 
     aim.Update_direction(mouse_coordinate);
     aim.Show_direction_sign();
 }
 
+void Game::Pan_camera(int allegro_keyboard_event_keycode)
+{
+    const float step = param::unit_length * 4;
+
+    switch (allegro_keyboard_event_keycode) {
+    case ALLEGRO_KEY_LEFT:
+        camera.Pan(Vector(-step, 0));
+        break;
+    case ALLEGRO_KEY_RIGHT:
+        camera.Pan(Vector(step, 0));
+        break;
+    case ALLEGRO_KEY_UP:
+        camera.Pan(Vector(0, -step));
+        break;
+    case ALLEGRO_KEY_DOWN:
+        camera.Pan(Vector(0, step));
+        break;
+    }
+}
+
 void Game::Add_pawn()
+// the local player's shot, for Play to fire
 {
     aim.Hide();
+    turn_chosen.Emit({aim.Center(), aim.Pawn_destination()});
+}
+
+sequence::Task<> Game::Play()
+// turn after turn: choose, fire, travel, then the other side or the end of the match
+{
+    while (true) {
+        std::optional<Turn> turn = co_await Next_turn();
+
+        if (turn) {
+            {
+                alloc::Scope tag{alloc::Tag::simulation};
+                match->Fire(*turn);
+            }
+
+            Change_state(State::shoot);
+            co_await Travel();
+
+            if (!match->Over()) {
+                Change_state(State::choose);
+                aim.Color(match->Active_king().Color());
+                continue;
+            }
+
+            // the last team standing is the one that just played
+            alloc::Scope tag{alloc::Tag::ui};
+            std::string message = std::string(param::team_names[match->Active_side()]) + " Win";
+            End_dialog().Add_message(message, match->Active_king().Color());
+            Change_state(State::end);
+        }
+
+        int choice = co_await end_choice;
 
-    active_pawns->emplace_back(aim.Center(), active_king->Color());
+        while (choice != 0 && choice != 1)
+            choice = co_await end_choice;
 
-    Pawn::Update_translation(aim.Center(), aim.Pawn_destination());
-    Pawn::Reset_translation_step_count();
-    state = State::shoot;
+        if (choice == 1 || network_failed) {
+            quitting = true;
+            co_return;
+        }
+
+        match->Reset();
+        aim.Color(match->Active_king().Color());
+        Change_state(State::choose);
+        End_dialog().Erase_message();
+    }
 }
 
-void Game::Move_pawn()
+sequence::Task<std::optional<Turn>> Game::Next_turn()
+// none when the network failed, the end dialog box then says why
 {
-    active_pawns->back().Move();
-    // trail.emplace_back(active_pawns->back().Last_translation());
-
-    active_pawns->back().Kill(*passive_pawns, vanishing_pawns);
+    if (!Local_turn())
+        co_return co_await Receive_turn();
 
-    active_pawns->back().Stopped_by(*active_king, aim.Center());
-    active_pawns->back().Hurt(*passive_king);
+    Turn turn = co_await turn_chosen;
 
-    map_1.Wall_stop(active_pawns->back());
-    map_1.Tree_stop(active_pawns->back());
-    map_1.X_kill(active_pawns->back(), vanishing_pawns);
-    map_1.Window_only_shoot(active_pawns->back());
+    if (peer && !peer->Send(lockstep::Make_message(*match, turn))) {
+        Network_failure("Disconnected");
+        co_return std::nullopt;
+    }
 
-    fence.Kill(active_pawns->back(), vanishing_pawns);
+    co_return turn;
 }
 
-void Game::Clean_pawn()
+sequence::Task<std::optional<Turn>> Game::Receive_turn()
+// the other player's turn, polled once a tick until it arrives
 {
-    if (Pawn::Vanish_immediately() && Pawn::Finish_moving()) {
-        active_pawns->pop_back();
-        Pawn::Vanish_immediately(false);
-    } else if (vanishing_pawns.empty() && Pawn::Finish_moving()) {
-        passive_king->Update_life();
+    lockstep::Message message;
 
-        if (passive_king->Life() == 0) {
-            std::string message = passive_king == &king_magenta ? "Cyan Win" : "Magenta Win";
-            pointer_to_end_dialog_box->Add_message(message, active_king->Color());
-            state = State::end;
-        } else {
-            std::swap(active_king, passive_king);
-            std::swap(active_pawns, passive_pawns);
+    while (true) {
+        co_await scheduler.Next_tick();
 
-            state = State::choose;
-            aim.Color(active_king->Color());
+        if (peer->Poll(message))
+            break;
+
+        if (peer->Failed()) {
+            Network_failure("Disconnected");
+            co_return std::nullopt;
         }
     }
 
-    for (auto it = vanishing_pawns.begin(); it != vanishing_pawns.end();) {
-        if (!(*it)->Color_equal_vanish()) {
-            (*it)->Transform_color_to_vanish();
-            ++it;
-            continue;
-        }
+    switch (lockstep::Verify(message, *match)) {
+    case lockstep::Check::ok:
+        trace::Instant("Remote_turn", "network");
+        co_return message.turn;
 
-        if (*it >= &pawns_magenta.front() && *it <= &pawns_magenta.back()) {
-            pawns_magenta.erase(pawns_magenta.begin() + (*it - &pawns_magenta.front()));
-        } else if (*it >= &pawns_cyan.front() && *it <= &pawns_cyan.back()) {
-            pawns_cyan.erase(pawns_cyan.begin() + (*it - &pawns_cyan.front()));
-        }
+    case lockstep::Check::wrong_turn:
+        Network_failure("Out of turn");
+        break;
 
-        it = vanishing_pawns.erase(it);
+    case lockstep::Check::desync:
+        Network_failure("Desync");
+        break;
+
+    case lockstep::Check::illegal_turn:
+        Network_failure("Illegal turn");
+        break;
     }
+
+    co_return std::nullopt;
 }
 
-void Game::Play_again_or_quit(bool &done)
+sequence::Task<> Game::Travel()
+// a sub-step a tick until the shot has settled; what it removed starts fading as it goes
 {
-    switch (pointer_to_end_dialog_box->Selected_choice_index()) {
-    case 0:
-        aim.Color(param::magenta);
+    while (match->Shooting()) {
+        co_await scheduler.Next_tick();
 
-        king_cyan.Reset_life();
-        king_magenta.Reset_life();
+        trace::Scope scope{"Simulate", "run"};
+        alloc::Scope tag{alloc::Tag::simulation};
+        match->Step();
+        Add_ghosts();
+    }
+}
 
-        pawns_cyan.clear();
-        pawns_magenta.clear();
+void Game::Network_failure(const std::string &message)
+{
+    std::cerr << message << " at turn " << match->Turn_count() << '\n';
+    trace::Instant("Network_failure", "network");
 
-        active_king = &king_magenta;
-        passive_king = &king_cyan;
+    network_failed = true;
+    End_dialog().Add_message(message, param::red);
+    Change_state(State::end);
+}
 
-        active_pawns = &pawns_magenta;
-        passive_pawns = &pawns_cyan;
-        vanishing_pawns.clear();
+void Game::Play_again_or_quit()
+{
+    end_choice.Emit(End_dialog().Selected_choice_index());
+}
 
-        state = State::choose;
+void Game::Change_state(State new_state)
+{
+    if (new_state == state)
+        return;
 
-        Pawn::Vanish_immediately(false);
+    trace::Instant(To_string(new_state), "state");
+    state = new_state;
+}
 
-        pointer_to_end_dialog_box->Erase_message();
+std::unique_ptr<lockstep::Peer> Game::Connect(const Option &option)
+// blocks until the other player is there, a failure falls back to a local game
+{
+    if (!option.Networked())
+        return nullptr;
 
-        break;
+    net::Connection connection;
+    std::string error;
 
-    case 1:
-        done = true;
-        break;
+    if (option.Host_port() != 0) {
+        net::Listener listener;
 
-    default:
-        break;
+        std::clog << "waiting for the other player on port " << option.Host_port() << '\n';
+
+        if (listener.Open(option.Host_port(), error) && listener.Accept(connection, error))
+            return std::make_unique<lockstep::Peer>(std::move(connection));
+    } else if (connection.Connect(option.Join_host(), option.Join_port(), error))
+        return std::make_unique<lockstep::Peer>(std::move(connection));
+
+    std::cerr << error << ", playing a local game instead\n";
+
+    return nullptr;
+}
+
+std::unique_ptr<spectator::Server> Game::Open_spectators(const Option &option)
+{
+    if (option.Spectator_port() == 0)
+        return nullptr;
+
+    auto server = std::make_unique<spectator::Server>();
+    std::string error;
+
+    if (!server->Open(option.Spectator_port(), error)) {
+        std::cerr << error << ", spectators disabled\n";
+        return nullptr;
     }
+
+    std::clog << "streaming to spectators on port " << server->Port() << '\n';
+
+    return server;
+}
+
+std::unique_ptr<capture::Recorder> Game::Start_capture(const Option &option)
+{
+    if (option.Capture_path().empty())
+        return nullptr;
+
+    auto recorder = std::make_unique<capture::Recorder>(param::window_width, param::window_height);
+
+    if (!recorder->Start(option.Capture_path())) {
+        std::cerr << "cannot open capture file " << option.Capture_path() << ", not capturing\n";
+        return nullptr;
+    }
+
+    return recorder;
+}
+
+void Game::Stop_capture()
+// waits for the encoder to write what is queued, then reports
+{
+    if (!recorder)
+        return;
+
+    capture::Report report = recorder->Stop();
+    recorder.reset();
+
+    std::clog << "captured " << report.captured << " of " << frame << " frames, " << report.dropped
+              << " dropped, " << report.written_bytes / 1024 << " KiB written ("
+              << (report.written_bytes ? static_cast<double>(report.raw_bytes) / report.written_bytes : 0)
+              << ":1), " << (report.captured ? report.encode_ms / report.captured : 0)
+              << " ms to encode a frame\n";
+}
+
+std::unique_ptr<telemetry::Publisher> Game::Open_telemetry(const Option &option)
+{
+    if (option.Telemetry_name().empty())
+        return nullptr;
+
+    auto publisher = std::make_unique<telemetry::Publisher>();
+    std::string error;
+
+    if (!publisher->Open(option.Telemetry_name(), error)) {
+        std::cerr << error << ", telemetry disabled\n";
+        return nullptr;
+    }
+
+    std::clog << "publishing telemetry in " << publisher->Name() << '\n';
+
+    return publisher;
+}
+
+void Game::Publish_telemetry(const alloc::Frame &heap)
+// after each frame shown
+{
+    static_assert(param::max_teams <= telemetry::max_teams);
+
+    double now = al_get_time();
+
+    if (now - rate_start_time >= 1) {
+        sample.ticks_per_second = (tick - rate_start_tick) / (now - rate_start_time);
+        rate_start_time = now;
+        rate_start_tick = tick;
+    }
+
+    sample.frame = frame;
+    sample.tick = tick;
+    sample.frame_ms = (now - last_flip_time) * 1000;
+    last_flip_time = now;
+
+    std::strncpy(sample.state, To_string(state), sizeof(sample.state) - 1);
+    sample.turn = match->Turn_count();
+    sample.team_count = match->Team_count();
+    std::fill(std::begin(sample.pawns), std::end(sample.pawns), 0);
+
+    for (const Pawn &pawn : match->Pawns())
+        sample.pawns[pawn.Team()]++;
+
+    sample.allocations = heap.Total().allocations;
+    sample.allocated_bytes = heap.Total().bytes;
+
+    monitor->Publish(sample);
+}
+
+std::unique_ptr<script::Driver> Game::Load_script(const Option &option)
+// after al_init, the driver's event source needs it
+{
+    if (option.Script_path().empty())
+        return nullptr;
+
+    auto driver = std::make_unique<script::Driver>();
+    std::string error;
+
+    if (!driver->Load(option.Script_path(), error)) {
+        std::cerr << error << ", playing without it\n";
+        return nullptr;
+    }
+
+    return driver;
+}
+
+void Game::Write_script_report() const
+{
+    if (script_report_path.empty()) {
+        driver->Write_report(std::cout, match->Turn_count(), match->Hash());
+        std::cout << "time_to_first_frame_ms " << time_to_first_frame_ms << '\n';
+
+        if (alloc::enabled)
+            allocations.Write(std::cout);
+
+        return;
+    }
+
+    std::ofstream report{script_report_path};
+    driver->Write_report(report, match->Turn_count(), match->Hash());
+    report << "time_to_first_frame_ms " << time_to_first_frame_ms << '\n';
+
+    if (alloc::enabled)
+        allocations.Write(report);
+
+    if (!report)
+        std::cerr << "cannot write script report " << script_report_path << '\n';
 }
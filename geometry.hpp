@@ -1,6 +1,13 @@
 #include <algorithm>
 #include <allegro5/allegro_primitives.h>
+#include <array>
 #include <math.h>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define GEOMETRY_HAS_SSE 1
+#else
+#define GEOMETRY_HAS_SSE 0
+#endif
 #pragma once
 
 bool Equal(float f1, float f2, float margin)
@@ -14,96 +21,123 @@ bool Equal(const ALLEGRO_COLOR &color_1, const ALLEGRO_COLOR &color_2, float mar
            && Equal(color_1.b, color_2.b, margin) && Equal(color_1.a, color_2.a, margin);
 }
 
-void Transform_color(ALLEGRO_COLOR &changed_color,
-                     const ALLEGRO_COLOR &target_color,
-                     float color_transformation_ratio)
+constexpr float Average(float f1, float f2)
 {
-    changed_color.r += (target_color.r - changed_color.r) * color_transformation_ratio;
-    changed_color.g += (target_color.g - changed_color.g) * color_transformation_ratio;
-    changed_color.b += (target_color.b - changed_color.b) * color_transformation_ratio;
-    changed_color.a += (target_color.a - changed_color.a) * color_transformation_ratio;
+    return (f1 + f2) / 2;
 }
 
-float Average(float f1, float f2)
+float Rsqrt(float f)
+// 1 / sqrt(f): the hardware estimate refined by one Newton step where SSE is available.
+// Not used by the game: the estimate differs between CPU vendors, and lockstep peers must
+// compute the same floats. benchmark kernels compares it with the exact path
 {
-    return (f1 + f2) / 2;
+#if GEOMETRY_HAS_SSE
+    float estimate = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(f)));
+
+    return estimate * (1.5f - 0.5f * f * estimate * estimate);
+#else
+    return 1 / sqrtf(f);
+#endif
+}
+
+constexpr float Absolute(float f)
+{
+    return f < 0 ? -f : f;
+}
+
+constexpr float Square_root(float f)
+// sqrtf that also works in constant expressions, for geometry baked at compile time
+{
+    if (f <= 0)
+        return 0;
+
+    double root = f < 1 ? 1 : f;
+
+    for (int i = 0; i < 64; i++) {
+        double next = (root + f / root) / 2;
+
+        if (next == root)
+            break;
+
+        root = next;
+    }
+
+    return static_cast<float>(root);
 }
 
 class Vector
 {
 public:
-    Vector(float x, float y)
+    constexpr Vector(float x, float y)
         : x{x}
         , y{y}
     {}
 
-    float X() const { return x; }
-    float Y() const { return y; }
+    constexpr float X() const { return x; }
+    constexpr float Y() const { return y; }
+
+    constexpr void X(float val) { x = val; }
+    constexpr void Y(float val) { y = val; }
 
-    void X(float val) { x = val; }
-    void Y(float val) { y = val; }
+    constexpr Vector operator-() const { return Vector(-x, -y); }
 
-    Vector operator-() const { return Vector(-x, -y); }
+    constexpr Vector operator+(const Vector &v) const { return Vector(x + v.x, y + v.y); }
 
-    Vector operator+(const Vector &v) const { return Vector(x + v.x, y + v.y); }
+    constexpr Vector operator-(const Vector &v) const { return Vector(x - v.x, y - v.y); }
 
-    Vector operator-(const Vector &v) const { return Vector(x - v.x, y - v.y); }
+    constexpr Vector operator*(float f) const { return Vector(x * f, y * f); }
 
-    Vector operator*(float f) const { return Vector(x * f, y * f); }
+    constexpr Vector operator/(float f) const { return Vector(x / f, y / f); }
 
-    Vector operator/(float f) const { return Vector(x / f, y / f); }
+    constexpr void operator*=(float f) { x *= f, y *= f; }
 
-    void operator*=(float f) { x *= f, y *= f; }
+    constexpr void operator/=(float f) { x /= f, y /= f; }
 
-    void operator/=(float f) { x /= f, y /= f; }
+    constexpr void operator+=(const Vector &v) { x += v.x, y += v.y; }
 
-    void operator+=(const Vector &v) { x += v.x, y += v.y; }
+    constexpr void operator-=(const Vector &v) { x -= v.x, y -= v.y; }
 
-    void operator-=(const Vector &v) { x -= v.x, y -= v.y; }
+    constexpr bool operator==(const Vector &v) const { return v.x == x && v.y == y; }
 
-    bool operator==(const Vector &v) const { return v.x == x && v.y == y; }
+    constexpr Vector Swap() const { return Vector(y, x); }
 
-    Vector Swap() const { return Vector(y, x); }
+    // rotated by -90 degrees, same as Matrix(0, 1, -1, 0) * *this
+    constexpr Vector Perpendicular() const { return Vector(y, -x); }
 
-    Vector Unit() const { return *this / sqrtf(x * x + y * y); }
+    Vector Unit() const { return *this / sqrtf(Magsq()); }
 
-    Vector Abs() const { return Vector(fabsf(x), fabsf(y)); }
+    constexpr Vector Abs() const { return Vector(Absolute(x), Absolute(y)); }
 
-    static float Dot(const Vector &v1, const Vector &v2);
+    static constexpr float Dot(const Vector &v1, const Vector &v2) { return v1.x * v2.x + v1.y * v2.y; }
 
-    float Magsq() const { return x * x + y * y; }
+    constexpr float Magsq() const { return x * x + y * y; }
 
 private:
     float x;
     float y;
 };
 
-Vector operator*(float f, const Vector &v)
+constexpr Vector operator*(float f, const Vector &v)
 {
     return v * f;
 };
 
-float Vector::Dot(const Vector &v1, const Vector &v2)
-{
-    return v1.x * v2.x + v1.y * v2.y;
-};
-
 class Matrix
 {
 public:
-    Matrix(float f1, float f2, float f3, float f4)
+    constexpr Matrix(float f1, float f2, float f3, float f4)
         : row_1{f1, f2}
         , row_2{f3, f4}
     {}
-    const Vector &Row_1() const { return row_1; }
-    const Vector &Row_2() const { return row_2; }
+    constexpr const Vector &Row_1() const { return row_1; }
+    constexpr const Vector &Row_2() const { return row_2; }
 
 private:
     Vector row_1;
     Vector row_2;
 };
 
-Vector operator*(const Matrix &m, const Vector &v)
+constexpr Vector operator*(const Matrix &m, const Vector &v)
 {
     return Vector(Vector::Dot(m.Row_1(), v), Vector::Dot(m.Row_2(), v));
 };
@@ -111,40 +145,40 @@ Vector operator*(const Matrix &m, const Vector &v)
 class Line
 {
 public:
-    Line(float x1, float y1, float x2, float y2)
+    constexpr Line(float x1, float y1, float x2, float y2)
         : start{x1, y1}
         , end{x2, y2}
     {}
 
-    Line(float x, float y, const Vector &end)
+    constexpr Line(float x, float y, const Vector &end)
         : start{x, y}
         , end{end}
     {}
 
-    Line(const Vector &start, float x, float y)
+    constexpr Line(const Vector &start, float x, float y)
         : start{start}
         , end{x, y}
     {}
 
-    Line(const Vector &start, const Vector &end)
+    constexpr Line(const Vector &start, const Vector &end)
         : start{start}
         , end{end}
     {}
 
-    void Translate(const Vector &displacement) { start += displacement, end += displacement; }
+    constexpr void Translate(const Vector &displacement) { start += displacement, end += displacement; }
 
-    const Vector &Start() const { return start; }
+    constexpr const Vector &Start() const { return start; }
 
-    const Vector &End() const { return end; }
+    constexpr const Vector &End() const { return end; }
 
-    float Length() const { return std::sqrtf((start - end).Magsq()); }
+    float Length() const { return sqrtf((start - end).Magsq()); }
 
     void Draw(const ALLEGRO_COLOR &color, float line_width) const
     {
         al_draw_line(start.X(), start.Y(), end.X(), end.Y(), color, line_width);
     }
 
-    Line Mirror_x(const Vector &point) const
+    constexpr Line Mirror_x(const Vector &point) const
     {
         Vector translate_start = Vector(0, (point - start).Y()) * 2;
         Vector translate_end = Vector(0, (point - end).Y()) * 2;
@@ -152,7 +186,7 @@ public:
         return Line(start + translate_start, end + translate_end);
     }
 
-    Line Mirror_y(const Vector &point) const
+    constexpr Line Mirror_y(const Vector &point) const
     {
         Vector translate_start = Vector((point - start).X(), 0) * 2;
         Vector translate_end = Vector((point - end).X(), 0) * 2;
@@ -160,9 +194,9 @@ public:
         return Line(start + translate_start, end + translate_end);
     }
 
-    Vector Direction() const { return end - start; }
+    constexpr Vector Direction() const { return end - start; }
 
-    Vector Center() const
+    constexpr Vector Center() const
     {
         return Vector(
             Average(start.X(), end.X()),
@@ -170,6 +204,19 @@ public:
         );
     }
 
+    constexpr Vector Closest_point_to(const Vector &point) const
+    {
+        Vector direction = Direction();
+        float length_squared = direction.Magsq();
+
+        if (length_squared == 0)
+            return start;
+
+        float t = std::clamp(Vector::Dot(point - start, direction) / length_squared, 0.f, 1.f);
+
+        return start + direction * t;
+    }
+
 private:
     Vector start;
     Vector end;
@@ -178,17 +225,17 @@ private:
 class Rectangle
 {
 public:
-    Rectangle(float x, float y, float w, float h)
+    constexpr Rectangle(float x, float y, float w, float h)
         : origin{x, y}
-        , size{fabsf(w), fabsf(h)}
+        , size{Absolute(w), Absolute(h)}
     {}
 
-    Rectangle(const Vector &origin, const Vector &size)
+    constexpr Rectangle(const Vector &origin, const Vector &size)
         : origin{origin}
         , size{size.Abs()}
     {}
 
-    Rectangle(const Vector &origin, float height)
+    constexpr Rectangle(const Vector &origin, float height)
         : origin{origin}
         , size{0, height}
     {}
@@ -212,17 +259,17 @@ public:
                           line_width);
     }
 
-    void Translate(const Vector &displacement) { origin += displacement; };
+    constexpr void Translate(const Vector &displacement) { origin += displacement; };
 
-    Line Top() const { return Line(origin, origin.X() + size.X(), origin.Y()); }
+    constexpr Line Top() const { return Line(origin, origin.X() + size.X(), origin.Y()); }
 
-    Line Right() const { return Line(origin + size, origin.X() + size.X(), origin.Y()); }
+    constexpr Line Right() const { return Line(origin + size, origin.X() + size.X(), origin.Y()); }
 
-    Line Bottom() const { return Line(origin + size, origin.X(), origin.Y() + size.Y()); }
+    constexpr Line Bottom() const { return Line(origin + size, origin.X(), origin.Y() + size.Y()); }
 
-    Line Left() const { return Line(origin, origin.X(), origin.Y() + size.Y()); }
+    constexpr Line Left() const { return Line(origin, origin.X(), origin.Y() + size.Y()); }
 
-    bool Contain(const Vector &point) const
+    constexpr bool Contain(const Vector &point) const
     {
         Vector distance_to_origin = point - origin;
 
@@ -230,21 +277,23 @@ public:
                && distance_to_origin.X() <= size.X() && distance_to_origin.Y() <= size.Y();
     }
 
-    const Vector &Size() const { return size; }
-    void Add_size_by(const Vector &value) { size += value; }
+    constexpr const Vector &Size() const { return size; }
+    constexpr void Add_size_by(const Vector &value) { size += value; }
 
-    float Width() const { return size.X(); }
-    void Width(float val) { size.X(val); }
+    constexpr float Width() const { return size.X(); }
+    constexpr void Width(float val) { size.X(val); }
 
-    float Height() const { return size.Y(); }
-    void Height(float val) { size.Y(val); }
+    constexpr float Height() const { return size.Y(); }
+    constexpr void Height(float val) { size.Y(val); }
 
-    const Vector &Origin() const { return origin; }
-    void Origin(const Vector &origin) { this->origin = origin; }
+    constexpr const Vector &Origin() const { return origin; }
+    constexpr void Origin(const Vector &origin) { this->origin = origin; }
 
-    Vector Center() const { return origin + size / 2; }
+    constexpr Vector Center() const { return origin + size / 2; }
 
-    Rectangle Mirror_x(const Vector &point) const
+    constexpr bool operator==(const Rectangle &r) const { return r.origin == origin && r.size == size; }
+
+    constexpr Rectangle Mirror_x(const Vector &point) const
     {
         Vector center = Center();
         Vector translate = Vector(0, (point - center).Y());
@@ -252,7 +301,7 @@ public:
         return Rectangle(center + translate * 2 - size / 2, size);
     }
 
-    Rectangle Mirror_y(const Vector &point) const
+    constexpr Rectangle Mirror_y(const Vector &point) const
     {
         Vector center = Center();
         Vector translate = Vector((point - center).X(), 0);
@@ -260,7 +309,7 @@ public:
         return Rectangle(center + translate * 2 - size / 2, size);
     }
 
-    Vector Closest_point_to(const Vector &point) const
+    constexpr Vector Closest_point_to(const Vector &point) const
     // return the point on the rectangle edge if arg is outside rectangle
     // return arg itself if arg is inside rectangle
     {
@@ -288,14 +337,22 @@ private:
     Vector size;
 };
 
+constexpr bool Overlap(const Rectangle &r1, const Rectangle &r2)
+{
+    return r1.Origin().X() <= r2.Origin().X() + r2.Width()
+           && r2.Origin().X() <= r1.Origin().X() + r1.Width()
+           && r1.Origin().Y() <= r2.Origin().Y() + r2.Height()
+           && r2.Origin().Y() <= r1.Origin().Y() + r1.Height();
+}
+
 class Circle
 {
 public:
-    Circle(float cx, float cy, float r)
+    constexpr Circle(float cx, float cy, float r)
         : center{cx, cy}
         , radius{r} {};
 
-    Circle(const Vector &center, float r)
+    constexpr Circle(const Vector &center, float r)
         : center{center}
         , radius{r} {};
 
@@ -309,41 +366,189 @@ public:
         al_draw_circle(center.X(), center.Y(), radius, line_color, line_width);
     }
 
-    void Translate(const Vector &displacement) { center += displacement; }
-    void Translate(float x, float y) { center += Vector(x, y); }
-    void Scale(float multiplier) { radius *= multiplier; }
-    void Add_radius_by(float value) { radius += value; }
+    constexpr void Translate(const Vector &displacement) { center += displacement; }
+    constexpr void Translate(float x, float y) { center += Vector(x, y); }
+    constexpr void Scale(float multiplier) { radius *= multiplier; }
+    constexpr void Add_radius_by(float value) { radius += value; }
 
-    bool Contain(const Vector &point) const { return (point - center).Magsq() <= radius * radius; }
+    constexpr bool Contain(const Vector &point) const { return (point - center).Magsq() <= radius * radius; }
 
-    const Vector &Center() const { return center; }
-    void Center(const Vector &position) { center = position; }
+    constexpr const Vector &Center() const { return center; }
+    constexpr void Center(const Vector &position) { center = position; }
 
-    float Radius() const { return radius; }
+    constexpr float Radius() const { return radius; }
 
-    Circle Mirror_x(const Vector &point) const
+    constexpr Circle Mirror_x(const Vector &point) const
     {
         Vector translate = Vector(0, (point - center).Y());
 
         return Circle(center + translate * 2, radius);
     }
 
-    Circle Mirror_y(const Vector &point) const
+    constexpr Circle Mirror_y(const Vector &point) const
     {
         Vector translate = Vector((point - center).X(), 0);
 
         return Circle(center + translate * 2, radius);
     }
 
+    constexpr Rectangle Bounds() const { return Rectangle(center - Vector(radius, radius), Vector(radius, radius) * 2); }
+
+    constexpr float Reach_from(const Vector &point) const
+    // distance from point to the farthest point of the circle
+    {
+        return Square_root((center - point).Magsq()) + radius;
+    }
+
 private:
     Vector center;
     float radius;
 };
 
+class Capsule
+// every point within radius of a segment; a radius of 0 is a plain segment
+{
+public:
+    constexpr Capsule(const Line &segment, float radius = 0)
+        : segment{segment}
+        , radius{radius}
+    {}
+
+    constexpr Capsule(const Vector &start, const Vector &end, float radius = 0)
+        : segment{start, end}
+        , radius{radius}
+    {}
+
+    void Draw(const ALLEGRO_COLOR &color, float line_width) const
+    {
+        segment.Draw(color, std::max(line_width, 2 * radius));
+    }
+
+    constexpr void Translate(const Vector &displacement) { segment.Translate(displacement); }
+
+    constexpr const Line &Segment() const { return segment; }
+    constexpr const Vector &Start() const { return segment.Start(); }
+    constexpr const Vector &End() const { return segment.End(); }
+    constexpr float Radius() const { return radius; }
+    float Length() const { return segment.Length(); }
+    constexpr Vector Center() const { return segment.Center(); }
+
+    constexpr Capsule Mirror_x(const Vector &point) const { return Capsule(segment.Mirror_x(point), radius); }
+    constexpr Capsule Mirror_y(const Vector &point) const { return Capsule(segment.Mirror_y(point), radius); }
+
+    constexpr Rectangle Bounds() const
+    {
+        Vector min = Vector(std::min(Start().X(), End().X()), std::min(Start().Y(), End().Y()));
+        Vector max = Vector(std::max(Start().X(), End().X()), std::max(Start().Y(), End().Y()));
+
+        return Rectangle(min - Vector(radius, radius), max - min + Vector(radius, radius) * 2);
+    }
+
+    constexpr float Reach_from(const Vector &point) const
+    // distance from point to the farthest point of the capsule
+    {
+        return Square_root(std::max((Start() - point).Magsq(), (End() - point).Magsq())) + radius;
+    }
+
+private:
+    Line segment;
+    float radius;
+};
+
+template <typename Primitive, std::size_t N>
+class Compound
+// N primitives stored in place, with a bounding box and circle around all of them
+// so a query can reject the whole group before looking at any child
+{
+public:
+    constexpr Compound(const std::array<Primitive, N> &children)
+        : children{children}
+        , bounding_box{0, 0, 0, 0}
+        , bounding_circle{0, 0, 0}
+    {
+        Update_bounds();
+    }
+
+    void Draw(const ALLEGRO_COLOR &color) const
+    {
+        for (const Primitive &child : children)
+            child.Draw(color);
+    }
+
+    void Draw(const ALLEGRO_COLOR &color, float line_width) const
+    {
+        for (const Primitive &child : children)
+            child.Draw(color, line_width);
+    }
+
+    constexpr void Translate(const Vector &displacement)
+    {
+        for (Primitive &child : children)
+            child.Translate(displacement);
+
+        bounding_box.Translate(displacement);
+        bounding_circle.Translate(displacement);
+    }
+
+    constexpr Compound Mirror_x(const Vector &point) const
+    {
+        std::array<Primitive, N> mirrored = children;
+
+        for (Primitive &child : mirrored)
+            child = child.Mirror_x(point);
+
+        return Compound(mirrored);
+    }
+
+    constexpr Compound Mirror_y(const Vector &point) const
+    {
+        std::array<Primitive, N> mirrored = children;
+
+        for (Primitive &child : mirrored)
+            child = child.Mirror_y(point);
+
+        return Compound(mirrored);
+    }
+
+    constexpr const std::array<Primitive, N> &Children() const { return children; }
+    constexpr const Rectangle &Bounding_box() const { return bounding_box; }
+    constexpr const Circle &Bounding_circle() const { return bounding_circle; }
+
+private:
+    constexpr void Update_bounds()
+    {
+        Rectangle first = children.front().Bounds();
+        Vector min = first.Origin();
+        Vector max = first.Origin() + first.Size();
+
+        for (const Primitive &child : children) {
+            Rectangle bounds = child.Bounds();
+
+            min = Vector(std::min(min.X(), bounds.Origin().X()), std::min(min.Y(), bounds.Origin().Y()));
+            max = Vector(std::max(max.X(), bounds.Origin().X() + bounds.Width()),
+                         std::max(max.Y(), bounds.Origin().Y() + bounds.Height()));
+        }
+
+        bounding_box = Rectangle(min, max - min);
+
+        Vector center = bounding_box.Center();
+        float radius = 0;
+
+        for (const Primitive &child : children)
+            radius = std::max(radius, child.Reach_from(center));
+
+        bounding_circle = Circle(center, radius);
+    }
+
+    std::array<Primitive, N> children;
+    Rectangle bounding_box;
+    Circle bounding_circle;
+};
+
 class Triangle
 {
 public:
-    Triangle(const Vector &vertex_1, const Vector &vertex_2, const Vector &vertex_3)
+    constexpr Triangle(const Vector &vertex_1, const Vector &vertex_2, const Vector &vertex_3)
         : vertex_1{vertex_1}
         , vertex_2{vertex_2}
         , vertex_3{vertex_3} {};
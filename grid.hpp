@@ -0,0 +1,124 @@
+#include "geometry.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#pragma once
+
+// Uniform grid over a rectangular region, storing small integer ids by their bounds.
+// An id is inserted into every cell its bounds touch, so a query only has to visit
+// the cells overlapping the queried area. Ids must be dense (0, 1, 2, ...) because
+// a per-id stamp is used to report each id once per query.
+
+class Uniform_grid
+{
+public:
+    Uniform_grid(const Rectangle &region, float cell_size)
+        : origin{region.Origin()}
+        , cell_size{cell_size}
+        , columns{std::max(1, static_cast<int>(ceilf(region.Width() / cell_size)))}
+        , rows{std::max(1, static_cast<int>(ceilf(region.Height() / cell_size)))}
+        , cells(columns * rows)
+    {}
+
+    void Insert(std::uint32_t id, const Rectangle &bounds)
+    {
+        if (id >= stamps.size())
+            stamps.resize(id + 1, 0);
+
+        For_each_cell(bounds, [&](std::vector<std::uint32_t> &cell) { cell.push_back(id); });
+    }
+
+    void Remove(std::uint32_t id, const Rectangle &bounds)
+    {
+        For_each_cell(bounds, [&](std::vector<std::uint32_t> &cell) {
+            auto it = std::find(cell.begin(), cell.end(), id);
+
+            if (it == cell.end())
+                return;
+
+            *it = cell.back();
+            cell.pop_back();
+        });
+    }
+
+    void Clear()
+    {
+        for (auto &cell : cells)
+            cell.clear();
+    }
+
+    template <typename Visit>
+    void Query(const Rectangle &bounds, Visit visit) const
+    // call visit(id) once for every id whose cells overlap bounds
+    {
+        query_stamp++;
+
+        For_each_cell(bounds, [&](const std::vector<std::uint32_t> &cell) {
+            for (std::uint32_t id : cell) {
+                if (stamps[id] == query_stamp)
+                    continue;
+
+                stamps[id] = query_stamp;
+                visit(id);
+            }
+        });
+    }
+
+    template <typename Visit>
+    void Query(const Vector &point, Visit visit) const
+    // call visit(id) for the ids in the single cell under point, stop when visit returns true
+    {
+        int column = Column(point.X());
+        int row = Row(point.Y());
+
+        for (std::uint32_t id : cells[row * columns + column])
+            if (visit(id))
+                return;
+    }
+
+    float Cell_size() const { return cell_size; }
+
+private:
+    int Column(float x) const
+    {
+        return std::clamp(static_cast<int>(floorf((x - origin.X()) / cell_size)), 0, columns - 1);
+    }
+
+    int Row(float y) const
+    {
+        return std::clamp(static_cast<int>(floorf((y - origin.Y()) / cell_size)), 0, rows - 1);
+    }
+
+    template <typename Cell_function>
+    void For_each_cell(const Rectangle &bounds, Cell_function function)
+    {
+        Visit_cells(cells, bounds, function);
+    }
+
+    template <typename Cell_function>
+    void For_each_cell(const Rectangle &bounds, Cell_function function) const
+    {
+        Visit_cells(cells, bounds, function);
+    }
+
+    template <typename Cells, typename Cell_function>
+    void Visit_cells(Cells &grid_cells, const Rectangle &bounds, Cell_function function) const
+    {
+        int first_column = Column(bounds.Origin().X());
+        int last_column = Column(bounds.Origin().X() + bounds.Width());
+        int first_row = Row(bounds.Origin().Y());
+        int last_row = Row(bounds.Origin().Y() + bounds.Height());
+
+        for (int row = first_row; row <= last_row; row++)
+            for (int column = first_column; column <= last_column; column++)
+                function(grid_cells[row * columns + column]);
+    }
+
+    Vector origin;
+    float cell_size;
+    int columns;
+    int rows;
+    std::vector<std::vector<std::uint32_t>> cells;
+    mutable std::vector<std::uint32_t> stamps;
+    mutable std::uint32_t query_stamp = 0;
+};
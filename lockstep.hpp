@@ -0,0 +1,177 @@
+#include "match.hpp"
+#include "net.hpp"
+#include <cstdint>
+#include <cstring>
+#pragma once
+
+// Lockstep protocol for two players.
+//
+// The player whose turn it is sends one fixed-size message, and both sides apply the
+// turn to their own Match. Every message also carries the turn number and the hash of
+// the sender's match right before the turn, which the receiver compares with its own,
+// so a desync shows up at the latest one turn after it happened.
+//
+// Message layout, little endian, 28 bytes:
+//     u32 turn number   (Match::Turn_count before the turn)
+//     f32 origin x, origin y, destination x, destination y
+//     u64 hash          (Match::Hash before the turn)
+
+namespace lockstep {
+const std::size_t message_size = 28;
+
+struct Message
+{
+    std::uint32_t turn_number = 0;
+    Turn turn;
+    std::uint64_t hash = 0;
+};
+
+// illegal_turn: a turn Match::Can_fire refuses, from a position the sender does not hold
+// or aimed anywhere but the reach circle
+enum class Check { ok, wrong_turn, desync, illegal_turn };
+
+void Encode(const Message &message, unsigned char *bytes);
+Message Decode(const unsigned char *bytes);
+Message Make_message(const Match &match, const Turn &turn);
+Check Verify(const Message &message, const Match &match);
+
+class Peer
+// one end of the connection, reassembling whole messages out of the byte stream
+{
+public:
+    Peer(net::Connection connection)
+        : connection{std::move(connection)}
+    {}
+
+    bool Send(const Message &message);
+    bool Poll(Message &message, int timeout_ms = 0);
+
+    bool Failed() const { return failed; }
+    std::size_t Bytes_sent() const { return bytes_sent; }
+    std::size_t Bytes_received() const { return bytes_received; }
+
+private:
+    net::Connection connection;
+    unsigned char buffer[message_size];
+    std::size_t buffered = 0;
+    bool failed = false;
+    std::size_t bytes_sent = 0;
+    std::size_t bytes_received = 0;
+};
+}; // namespace lockstep
+
+namespace {
+void Put_bytes(unsigned char *&bytes, std::uint64_t value, int size)
+{
+    for (int i = 0; i < size; i++)
+        *bytes++ = static_cast<unsigned char>(value >> (i * 8));
+}
+
+std::uint64_t Get_bytes(const unsigned char *&bytes, int size)
+{
+    std::uint64_t value = 0;
+
+    for (int i = 0; i < size; i++)
+        value |= static_cast<std::uint64_t>(*bytes++) << (i * 8);
+
+    return value;
+}
+
+void Put_float(unsigned char *&bytes, float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    Put_bytes(bytes, bits, 4);
+}
+
+float Get_float(const unsigned char *&bytes)
+{
+    std::uint32_t bits = static_cast<std::uint32_t>(Get_bytes(bytes, 4));
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+} // namespace
+
+void lockstep::Encode(const Message &message, unsigned char *bytes)
+{
+    Put_bytes(bytes, message.turn_number, 4);
+    Put_float(bytes, message.turn.origin.X());
+    Put_float(bytes, message.turn.origin.Y());
+    Put_float(bytes, message.turn.destination.X());
+    Put_float(bytes, message.turn.destination.Y());
+    Put_bytes(bytes, message.hash, 8);
+}
+
+lockstep::Message lockstep::Decode(const unsigned char *bytes)
+{
+    std::uint32_t turn_number = static_cast<std::uint32_t>(Get_bytes(bytes, 4));
+    float origin_x = Get_float(bytes);
+    float origin_y = Get_float(bytes);
+    float destination_x = Get_float(bytes);
+    float destination_y = Get_float(bytes);
+    std::uint64_t hash = Get_bytes(bytes, 8);
+
+    return {turn_number, {Vector(origin_x, origin_y), Vector(destination_x, destination_y)}, hash};
+}
+
+lockstep::Message lockstep::Make_message(const Match &match, const Turn &turn)
+// call before firing the turn locally
+{
+    return {match.Turn_count(), turn, match.Hash()};
+}
+
+lockstep::Check lockstep::Verify(const Message &message, const Match &match)
+// call before firing the received turn
+{
+    if (message.turn_number != match.Turn_count())
+        return Check::wrong_turn;
+
+    if (message.hash != match.Hash())
+        return Check::desync;
+
+    if (!match.Can_fire(message.turn))
+        return Check::illegal_turn;
+
+    return Check::ok;
+}
+
+bool lockstep::Peer::Send(const Message &message)
+{
+    unsigned char bytes[message_size];
+    Encode(message, bytes);
+
+    if (failed || !connection.Send(bytes, message_size)) {
+        failed = true;
+        return false;
+    }
+
+    bytes_sent += message_size;
+
+    return true;
+}
+
+bool lockstep::Peer::Poll(Message &message, int timeout_ms)
+// true once a whole message is in, a partial one stays buffered for the next call
+{
+    while (!failed && buffered < message_size) {
+        int received = connection.Receive(buffer + buffered, message_size - buffered, timeout_ms);
+
+        if (received < 0)
+            failed = true;
+
+        if (received <= 0)
+            return false;
+
+        buffered += received;
+        bytes_received += received;
+    }
+
+    if (failed)
+        return false;
+
+    message = Decode(buffer);
+    buffered = 0;
+
+    return true;
+}
@@ -0,0 +1,193 @@
+#include "lockstep.hpp"
+#include "map_generator.hpp"
+#include "match.hpp"
+#include "net.hpp"
+#include "option.hpp"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// lockstep_test [--turns count] [--seed seed] [--desync-at turn]
+//               [--malformed-at turn [--malformed nan|inf|far]] [game options ...]
+//     play random turns between two lockstep peers connected over 127.0.0.1 in this
+//     process, checking that the protocol keeps both matches identical. --desync-at
+//     nudges one turn on the receiving side, which the protocol must then report.
+//     --malformed-at sends one turn with a NaN or infinite destination, or one far
+//     beyond the reach circle, which the receiver must refuse rather than fire.
+//     Game options (--generate, --map, --world-scale, ...) pick the map for both.
+
+int main(int argc, char **argv)
+{
+    int turns = 1000;
+    std::uint64_t seed = 1;
+    long desync_at = -1;
+    long malformed_at = -1;
+    std::string malformed = "nan";
+    std::vector<char *> game_arguments{argv[0]};
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (argument == "--turns" && has_value)
+            turns = std::stoi(argv[++i]);
+
+        else if (argument == "--seed" && has_value)
+            seed = std::stoull(argv[++i]);
+
+        else if (argument == "--desync-at" && has_value)
+            desync_at = std::stol(argv[++i]);
+
+        else if (argument == "--malformed-at" && has_value)
+            malformed_at = std::stol(argv[++i]);
+
+        else if (argument == "--malformed" && has_value)
+            malformed = argv[++i];
+
+        else
+            game_arguments.push_back(argv[i]);
+    }
+
+    Option option = Option(static_cast<int>(game_arguments.size()), game_arguments.data());
+
+    if (option.Team_count() > 2) {
+        std::cerr << "lockstep needs two teams\n";
+        return 1;
+    }
+
+    net::Listener listener;
+    net::Connection host_connection;
+    net::Connection guest_connection;
+    std::string error;
+
+    // connect completes against the listen backlog, so one thread can do both ends
+    if (!listener.Open(0, error) || !guest_connection.Connect("127.0.0.1", listener.Port(), error)
+        || !listener.Accept(host_connection, error)) {
+        std::cerr << error << '\n';
+        return 1;
+    }
+
+    Match host_match = Match(option);
+    Match guest_match = Match(option);
+    Match *matches[2] = {&host_match, &guest_match};
+    lockstep::Peer peers[2] = {lockstep::Peer(std::move(host_connection)),
+                               lockstep::Peer(std::move(guest_connection))};
+
+    Random random = Random(seed);
+    int games = 0;
+    long sub_steps = 0;
+    long first_mismatch = -1; // first turn after which the two hashes differ
+    long reported_at = -1;
+    std::string report;
+
+    auto start = std::chrono::steady_clock::now();
+    int turn = 0;
+
+    for (; turn < turns && reported_at < 0; turn++) {
+        if (host_match.Over() || guest_match.Over()) {
+            host_match.Reset();
+            guest_match.Reset();
+            games++;
+        }
+
+        int sender = host_match.Active_side();
+        int receiver = 1 - sender;
+
+        Turn local_turn = Random_turn(*matches[sender], random);
+        lockstep::Message sent = lockstep::Make_message(*matches[sender], local_turn);
+
+        // what a broken or hostile peer could put on the wire
+        if (turn == malformed_at) {
+            if (malformed == "inf")
+                sent.turn.destination = Vector(INFINITY, local_turn.destination.Y());
+            else if (malformed == "far")
+                sent.turn.destination = local_turn.origin + Vector(1e7f, 0);
+            else
+                sent.turn.destination = Vector(NAN, NAN);
+        }
+
+        if (!peers[sender].Send(sent)) {
+            report = "send failed";
+            break;
+        }
+
+        matches[sender]->Fire(local_turn);
+
+        while (matches[sender]->Shooting()) {
+            matches[sender]->Step();
+            sub_steps++;
+        }
+
+        lockstep::Message message;
+
+        if (!peers[receiver].Poll(message, 1000)) {
+            report = "receive failed";
+            break;
+        }
+
+        switch (lockstep::Verify(message, *matches[receiver])) {
+        case lockstep::Check::ok:
+            break;
+
+        case lockstep::Check::wrong_turn:
+            report = "out of turn";
+            reported_at = turn;
+            continue;
+
+        case lockstep::Check::desync:
+            report = "desync";
+            reported_at = turn;
+            continue;
+
+        case lockstep::Check::illegal_turn:
+            report = "illegal turn";
+            reported_at = turn;
+            continue;
+        }
+
+        if (turn == desync_at)
+            message.turn.destination += Vector(param::unit_length, 0);
+
+        matches[receiver]->Fire(message.turn);
+
+        while (matches[receiver]->Shooting())
+            matches[receiver]->Step();
+
+        if (first_mismatch < 0 && host_match.Hash() != guest_match.Hash())
+            first_mismatch = turn;
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::size_t bytes = peers[0].Bytes_sent() + peers[1].Bytes_sent();
+
+    std::cout << "turns            " << turn << " in " << games << " finished games\n"
+              << "sub-steps        " << sub_steps << '\n'
+              << "bytes on wire    " << bytes << " (" << static_cast<double>(bytes) / turn
+              << " per turn)\n"
+              << "time             " << elapsed.count() << " ms (" << elapsed.count() * 1000 / turn
+              << " us per turn, both sides)\n";
+
+    if (reported_at >= 0)
+        std::cout << "protocol         " << report << " reported at turn " << reported_at << '\n';
+    else if (!report.empty())
+        std::cout << "protocol         " << report << '\n';
+    else
+        std::cout << "protocol         in sync\n";
+
+    if (first_mismatch >= 0)
+        std::cout << "hashes differ    from turn " << first_mismatch << '\n';
+
+    // every divergence must be reported on the very next turn, and none may happen
+    // unless --desync-at asked for one (a nudge can still land on the same result); a
+    // malformed turn must be refused on the turn it was sent
+    bool expected = first_mismatch < 0 ? report.empty()
+                                       : desync_at >= 0 && report == "desync"
+                                             && reported_at == first_mismatch + 1;
+
+    if (malformed_at >= 0)
+        expected = report == "illegal turn" && reported_at == malformed_at;
+
+    return expected ? 0 : 1;
+}
@@ -1,10 +1,19 @@
 #include "game.hpp"
+#include "option.hpp"
+#include "trace.hpp"
 
-int main()
+int main(int argc, char **argv)
 {
-    Game game = Game();
+    Option option = Option(argc, argv);
+
+    if (!option.Trace_path().empty() && !trace::Start(option.Trace_path()))
+        std::cerr << "cannot open trace file " << option.Trace_path() << '\n';
+
+    Game game = Game(option);
 
     game.Run();
 
+    trace::Stop();
+
     return 0;
 }
@@ -1,31 +1,38 @@
 #include "character.hpp"
 #include "collision.hpp"
 #include "geometry.hpp"
+#include "grid.hpp"
+#include "map_file.hpp"
 #include "object.hpp"
 #include "param.hpp"
 #include <algorithm>
 #include <array>
+#include <optional>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #pragma once
 
 class Wall
 {
 public:
-    Wall(const Vector &origin, const Vector &size)
+    constexpr Wall(const Vector &origin, const Vector &size)
         : shape{origin, size}
     {}
 
     void Draw() const { shape.Draw(param::yellow); }
 
-    const Rectangle &Shape() const { return shape; }
+    constexpr const Rectangle &Shape() const { return shape; }
 
-    void Translate(const Vector &displacement) { shape.Translate(displacement); }
+    constexpr const Rectangle &Bounds() const { return shape; }
 
-    float Width() const { return shape.Width(); }
+    constexpr void Translate(const Vector &displacement) { shape.Translate(displacement); }
 
-    float Height() const { return shape.Height(); }
+    constexpr float Width() const { return shape.Width(); }
 
-    Wall Mirror_x(const Vector &point) const
+    constexpr float Height() const { return shape.Height(); }
+
+    constexpr Wall Mirror_x(const Vector &point) const
     {
         Wall temp = *this;
         temp.shape = temp.shape.Mirror_x(point);
@@ -33,7 +40,7 @@ public:
         // return Wall(shape.Mirror_x(point));
     }
 
-    Wall Mirror_y(const Vector &point) const
+    constexpr Wall Mirror_y(const Vector &point) const
     {
         Wall temp = *this;
         temp.shape = temp.shape.Mirror_y(point);
@@ -49,367 +56,476 @@ private:
 class Tree
 {
 public:
-    Tree(const Vector &center, float overall_diameter)
+    constexpr Tree(const Vector &center, float overall_diameter)
         : diameter{overall_diameter}
-        , shape{6, Circle(center, overall_diameter / 6)}
-        , filler{center, shape.front().Radius() * 1.7321f}
-    {
-        std::array<float, 6> xs{1, 0.5f, -0.5f, -1, -0.5f, 0.5f};
-        std::array<float, 6> ys{0, 0.5f, 0.5f, 0, -0.5f, -0.5f};
-
-        std::for_each(shape.begin(), shape.end(), [&, i = 0](Circle &c) mutable {
-            c.Translate(2 * c.Radius() * xs.at(i), 2 * c.Radius() * ys.at(i) * param::sqrt_3);
-
-            i++;
-        });
-    }
+        , shape{Lobes(center, overall_diameter)}
+        , filler{center, overall_diameter / 6 * 1.7321f}
+    {}
 
     void Draw() const
     {
-        std::for_each(shape.begin(), shape.end(), [](const Circle &c) { c.Draw(param::green); });
+        shape.Draw(param::green);
 
         filler.Draw(param::green);
     }
 
-    void Translate(const Vector &displacement)
+    constexpr void Translate(const Vector &displacement)
     {
-        std::for_each(shape.begin(), shape.end(), [&](Circle &c) { c.Translate(displacement); });
+        shape.Translate(displacement);
 
         filler.Translate(displacement);
     }
 
-    void Translate(float x, float y)
-    {
-        std::for_each(shape.begin(), shape.end(), [&](Circle &c) { c.Translate(x, y); });
+    constexpr void Translate(float x, float y) { Translate(Vector(x, y)); }
 
-        filler.Translate(x, y);
-    }
+    constexpr float Diameter() const { return diameter; }
 
-    float Diameter() const { return diameter; }
+    constexpr const Vector &Center() const { return filler.Center(); }
 
-    Tree Mirror_x(const Vector &point) const
+    constexpr const Rectangle &Bounds() const { return shape.Bounding_box(); }
+
+    constexpr Tree Mirror_x(const Vector &point) const
     {
         Tree temp = *this;
 
         temp.filler = temp.filler.Mirror_x(point);
-
-        std::transform(temp.shape.begin(),
-                       temp.shape.end(),
-                       temp.shape.begin(),
-                       [&](const Circle &c) { return c.Mirror_x(point); });
+        temp.shape = temp.shape.Mirror_x(point);
 
         return temp;
     }
 
-    float Min_t(const Pawn &moving_pawn) const
+    float Min_t(const Pawn &moving_pawn, const Shot &shot) const
     {
-        std::vector<float> t;
-        t.reserve(shape.size());
-
-        for (const Circle &circle : shape)
-            t.push_back(collision::Circle_vs_circle(moving_pawn.Shape(),
-                                                    circle,
-                                                    moving_pawn.Last_translation()));
-
-        return *std::min_element(t.begin(), t.end());
+        return collision::Circle_vs_compound(moving_pawn.Shape(), shape, moving_pawn.Last_translation(shot));
     }
 
 private:
+    static constexpr std::array<Circle, 6> Lobes(const Vector &center, float overall_diameter)
+    {
+        constexpr float xs[6] = {1, 0.5f, -0.5f, -1, -0.5f, 0.5f};
+        constexpr float ys[6] = {0, 0.5f, 0.5f, 0, -0.5f, -0.5f};
+        std::array<Circle, 6> lobes{Circle(center, overall_diameter / 6),
+                                    Circle(center, overall_diameter / 6),
+                                    Circle(center, overall_diameter / 6),
+                                    Circle(center, overall_diameter / 6),
+                                    Circle(center, overall_diameter / 6),
+                                    Circle(center, overall_diameter / 6)};
+
+        for (int i = 0; i < 6; i++)
+            lobes[i].Translate(2 * lobes[i].Radius() * xs[i],
+                               2 * lobes[i].Radius() * ys[i] * param::sqrt_3);
+
+        return lobes;
+    }
+
     float diameter;
-    std::vector<Circle> shape;
+    Compound<Circle, 6> shape; // the lobes, filler only fills the gap between them on screen
     Circle filler;
 };
 
 class X
 {
 public:
-    X(const Vector &center, float size)
+    constexpr X(const Vector &center, float size)
         : size{size}
-        , shape{Line(center, center + Vector(size, size) / 2),
-                Line(center, center - Vector(size, size) / 2),
-                Line(center, center + Vector(-size, size) / 2),
-                Line(center, center + Vector(size, -size) / 2)}
+        , shape{std::array<Capsule, 4>{Capsule(center, center + Vector(size, size) / 2),
+                                       Capsule(center, center - Vector(size, size) / 2),
+                                       Capsule(center, center + Vector(-size, size) / 2),
+                                       Capsule(center, center + Vector(size, -size) / 2)}}
     {}
 
-    void Draw() const
-    {
-        std::for_each(shape.begin(), shape.end(), [](const Line &l) {
-            l.Draw(param::red, param::line_width * 2);
-        });
-    }
+    void Draw() const { shape.Draw(param::red, param::line_width * 2); }
 
-    void Translate(const Vector &displacement)
-    {
-        std::for_each(shape.begin(), shape.end(), [&](Line &l) { l.Translate(displacement); });
-    }
+    constexpr void Translate(const Vector &displacement) { shape.Translate(displacement); }
 
-    float Size() const { return size; }
+    constexpr float Size() const { return size; }
 
-    float Min_t(const Pawn &moving_pawn) const
-    {
-        std::vector<float> t;
-        t.reserve(shape.size());
+    constexpr const Vector &Center() const { return shape.Children().front().Start(); }
 
-        for (const Line &line : shape)
-            t.push_back(collision::Circle_vs_line(moving_pawn.Shape(),
-                                                  line,
-                                                  moving_pawn.Last_translation()));
+    constexpr const Rectangle &Bounds() const { return shape.Bounding_box(); }
 
-        return *std::min_element(t.begin(), t.end());
+    float Min_t(const Pawn &moving_pawn, const Shot &shot) const
+    {
+        return collision::Circle_vs_compound(moving_pawn.Shape(), shape, moving_pawn.Last_translation(shot));
     }
 
 private:
     float size;
-    std::array<Line, 4> shape;
+    Compound<Capsule, 4> shape;
 };
 
 class Window
 {
 public:
-    Window(const Vector &start, const Vector &end)
-        : shape{start, end}
+    constexpr Window(const Vector &start, const Vector &end)
+        : segment{start, end}
     {}
 
-    void Draw() const { shape.Draw(param::blue, param::line_width * 2); }
+    void Draw() const { Shape().Draw(param::blue, param::line_width * 2); }
 
-    void Translate(const Vector &displacement) { shape.Translate(displacement); }
+    constexpr void Translate(const Vector &displacement) { segment.Translate(displacement); }
 
-    float Length() const { return shape.Length(); }
+    float Length() const { return segment.Length(); }
 
-    const Line &Shape() const { return shape; }
+    // a capsule of radius 0, only the segment is stored so a Window is its file record
+    constexpr Capsule Shape() const { return Capsule(segment); }
 
-    Vector Center() const { return shape.Center(); }
+    constexpr Vector Center() const { return segment.Center(); }
+
+    constexpr Rectangle Bounds() const
+    {
+        return Rectangle(Vector(std::min(segment.Start().X(), segment.End().X()),
+                                std::min(segment.Start().Y(), segment.End().Y())),
+                         segment.Direction());
+    }
 
 private:
-    Line shape;
+    Line segment;
 };
 
-class Map
+// A Wall and a Window hold exactly the floats of their records, in the same order, so
+// the records of a compiled map are used as the obstacles in place, see Loaded_map.
+static_assert(sizeof(Wall) == sizeof(map_file::Wall_record) && std::is_standard_layout_v<Wall>
+              && std::is_trivially_copyable_v<Wall>);
+static_assert(sizeof(Window) == sizeof(map_file::Window_record) && std::is_standard_layout_v<Window>
+              && std::is_trivially_copyable_v<Window>);
+
+template <typename Obstacle>
+class View
+// read only range over obstacles owned elsewhere: a static table, a member array or a vector
 {
 public:
-    void Draw() const
-    {
-        for (const Window &window : windows)
-            window.Draw();
+    constexpr View() = default;
+
+    template <typename Container>
+    constexpr View(const Container &container)
+        : first{container.data()}
+        , count{container.size()}
+    {}
+
+    constexpr View(const Obstacle *first, std::size_t count)
+        : first{first}
+        , count{count}
+    {}
+
+    constexpr const Obstacle *begin() const { return first; }
+    constexpr const Obstacle *end() const { return first + count; }
+    constexpr const Obstacle &operator[](std::size_t i) const { return first[i]; }
+    constexpr const Obstacle &front() const { return first[0]; }
+    constexpr const Obstacle &back() const { return first[count - 1]; }
+    constexpr std::size_t size() const { return count; }
 
-        for (const Wall &wall : walls)
-            wall.Draw();
+private:
+    const Obstacle *first = nullptr;
+    std::size_t count = 0;
+};
 
-        for (const Tree &tree : trees)
-            tree.Draw();
+class Map
+{
+public:
+    virtual ~Map() = default;
 
-        for (const X &x : xs)
-            x.Draw();
+    void Draw(const Rectangle &view) const
+    // draw only the obstacles whose bounds overlap view
+    {
+        Query(view, [](const auto &obstacle) { obstacle.Draw(); });
     }
 
-    void Wall_stop(Pawn &moving_pawn) const
+    template <typename Visit>
+    void Query(const Rectangle &bounds, Visit visit) const
+    // visit(obstacle) with each Window, Wall, Tree and X whose bounds overlap bounds, in
+    // draw order: the windows, walls, trees and xs, each kind in the order it was placed
+    {
+        visible.clear();
+        index.Query(bounds, [&](std::uint32_t id) { visible.push_back(id); });
+
+        // ids follow the draw order
+        std::sort(visible.begin(), visible.end());
+
+        for (std::uint32_t id : visible) {
+            if (id < first_wall)
+                visit(windows[id]);
+            else if (id < first_tree)
+                visit(walls[id - first_wall]);
+            else if (id < first_x)
+                visit(trees[id - first_tree]);
+            else
+                visit(xs[id - first_x]);
+        }
+    }
+
+    void Wall_stop(Pawn &moving_pawn, Shot &shot) const
     {
         std::for_each(walls.begin(), walls.end(), [&](const Wall &wall) {
             float t = collision::Circle_vs_rectangle(moving_pawn.Shape(),
                                                      wall.Shape(),
-                                                     moving_pawn.Last_translation());
+                                                     moving_pawn.Last_translation(shot));
 
             if (t == 2)
                 return;
 
-            moving_pawn.Retreat(1 - t);
-            moving_pawn.Stop();
+            moving_pawn.Retreat(1 - t, shot);
+            shot.Stop();
         });
     }
 
-    void Tree_stop(Pawn &moving_pawn) const
+    void Tree_stop(Pawn &moving_pawn, Shot &shot) const
     {
         std::for_each(trees.begin(), trees.end(), [&](const Tree &tree) {
-            float t = tree.Min_t(moving_pawn);
+            float t = tree.Min_t(moving_pawn, shot);
 
             if (t == 2)
                 return;
 
-            moving_pawn.Retreat(1 - t);
-            moving_pawn.Stop();
+            moving_pawn.Retreat(1 - t, shot);
+            shot.Stop();
         });
     }
 
-    void X_kill(Pawn &moving_pawn, std::set<Pawn *> &dying_pawns) const
+    void X_kill(Pawn &moving_pawn, Shot &shot) const
     {
         std::for_each(xs.begin(), xs.end(), [&](const X &x) {
-            float t = x.Min_t(moving_pawn);
+            float t = x.Min_t(moving_pawn, shot);
 
-            if (t == 2 || Pawn::Vanish_immediately())
+            if (t == 2 || shot.Vanish_immediately())
                 return;
 
-            moving_pawn.Retreat(1 - t);
-            moving_pawn.Stop();
-            dying_pawns.insert(&moving_pawn);
+            moving_pawn.Retreat(1 - t, shot);
+            shot.Stop();
+            moving_pawn.Die();
         });
     }
 
-    void Window_only_shoot(Pawn &moving_pawn) const
+    void Window_only_shoot(const Pawn &moving_pawn, Shot &shot) const
     {
         std::for_each(windows.begin(), windows.end(), [&](const Window &window) {
-            float t = collision::Circle_vs_line(moving_pawn.Shape(),
-                                                window.Shape(),
-                                                moving_pawn.Last_translation());
+            float t = collision::Circle_vs_capsule(moving_pawn.Shape(),
+                                                   window.Shape(),
+                                                   moving_pawn.Last_translation(shot));
 
             if (t != 2)
-                Pawn::Vanish_immediately(true);
+                shot.Vanish_immediately(true);
         });
     }
 
 protected:
-    Map(const Fence &fence,
-        float the_number_of_walls,
-        float the_number_of_windows,
-        float the_number_of_xs,
-        float the_number_of_trees)
+    Map(const Fence &fence)
         : fence{fence}
+        , index{fence.Shape(), param::unit_length * 16}
+    {}
+
+    void Place(View<Wall> walls, View<Window> windows, View<X> xs, View<Tree> trees)
+    // call once every obstacle is in place, the obstacles must outlive the map
     {
-        walls.reserve(the_number_of_walls);
-        windows.reserve(the_number_of_windows);
-        xs.reserve(the_number_of_xs);
-        trees.reserve(the_number_of_trees);
+        this->walls = walls;
+        this->windows = windows;
+        this->xs = xs;
+        this->trees = trees;
+
+        first_wall = windows.size();
+        first_tree = first_wall + walls.size();
+        first_x = first_tree + trees.size();
+
+        index.Clear();
+
+        for (std::size_t i = 0; i < windows.size(); i++)
+            index.Insert(i, windows[i].Bounds());
+
+        for (std::size_t i = 0; i < walls.size(); i++)
+            index.Insert(first_wall + i, walls[i].Bounds());
+
+        for (std::size_t i = 0; i < trees.size(); i++)
+            index.Insert(first_tree + i, trees[i].Bounds());
+
+        for (std::size_t i = 0; i < xs.size(); i++)
+            index.Insert(first_x + i, xs[i].Bounds());
     }
 
     const Fence &fence;
-    std::vector<Wall> walls;
-    std::vector<Window> windows;
-    std::vector<X> xs;
-    std::vector<Tree> trees;
+
+private:
+    View<Wall> walls;
+    View<Window> windows;
+    View<X> xs;
+    View<Tree> trees;
+    Uniform_grid index;
+    std::uint32_t first_wall = 0;
+    std::uint32_t first_tree = 0;
+    std::uint32_t first_x = 0;
+    mutable std::vector<std::uint32_t> visible;
 };
 
-class Map_1 : public Map
+namespace map_1 {
+// The first built-in map as constexpr functions of the fence, so the layout for the
+// default window is computed by the compiler into the static tables below.
+
+constexpr float size = param::unit_length * 6; // of every wall, x and tree, and window length
+
+struct Layout
 {
-public:
-    Map_1(const Fence &fence)
-        : Map{fence, 6, 4, 2, 2}
-    {
-        for (int i = 0; i < walls.capacity(); i++)
-            walls.emplace_back(fence.Origin(), Vector(param::unit_length, param::unit_length) * 6);
+    std::array<Wall, 6> walls;
+    std::array<Window, 4> windows;
+    std::array<X, 2> xs;
+    std::array<Tree, 4> trees;
+};
 
-        for (int i = 0; i < windows.capacity(); i++)
-            windows.emplace_back(fence.Origin(), fence.Origin() + Vector(0, walls.front().Height()));
+constexpr std::array<Wall, 6> Walls(const Rectangle &fence)
+// two columns of three, a wall apart, left and right of the fence center
+{
+    std::array<Wall, 6> walls{Wall(fence.Origin(), Vector(size, size)),
+                              Wall(fence.Origin(), Vector(size, size)),
+                              Wall(fence.Origin(), Vector(size, size)),
+                              Wall(fence.Origin(), Vector(size, size)),
+                              Wall(fence.Origin(), Vector(size, size)),
+                              Wall(fence.Origin(), Vector(size, size))};
+
+    for (int i = 0; i < 6; i++) {
+        float x = i % 2 == 0 ? fence.Width() / 4 - size : fence.Width() * 3 / 4;
+        float y = fence.Height() / 2 - size / 2 + (i / 2 - 1) * size * 2;
+
+        walls[i].Translate(Vector(x, y));
+    }
 
-        for (int i = 0; i < xs.capacity(); i++)
-            xs.emplace_back(Vector(0, 0), param::unit_length * 6);
+    return walls;
+}
 
-        for (int i = 0; i < trees.capacity(); i++)
-            trees.emplace_back(fence.Center(), param::unit_length * 6);
+constexpr std::array<Window, 4> Windows(const Rectangle &fence)
+// in the gaps between the walls of each column
+{
+    std::array<Window, 4> windows{Window(fence.Origin(), fence.Origin() + Vector(0, size)),
+                                  Window(fence.Origin(), fence.Origin() + Vector(0, size)),
+                                  Window(fence.Origin(), fence.Origin() + Vector(0, size)),
+                                  Window(fence.Origin(), fence.Origin() + Vector(0, size))};
 
-        // Don't change this functions call order:
-        arrange_walls();
-        arrange_windows();
-        arrange_xs();
-        arrange_trees();
+    for (int i = 0; i < 4; i++) {
+        float x = i % 2 == 0 ? fence.Width() / 4 - size / 2 : fence.Width() * 3 / 4 + size / 2;
+        float y = fence.Height() / 2 - size / 2 + (i < 2 ? -size : size);
+
+        windows[i].Translate(Vector(x, y));
     }
 
-private:
-    void arrange_walls()
-    {
-        // std::vector<Wall> corners{3, walls.front()};
-        // corners.at(1).Translate(Vector(corners.front().Width(), 0));
-        // corners.at(2).Translate(Vector(0, corners.front().Height()));
+    return windows;
+}
 
-        std::for_each(walls.begin(), walls.end(), [&, i = 0](Wall &wall) mutable {
-            if (i % 2 == 0)
-                wall.Translate(Vector(fence.Width() / 4 - wall.Width(), 0));
-            else
-                wall.Translate(Vector(fence.Width() * 3 / 4, 0));
+constexpr std::array<X, 2> Xs(const Rectangle &fence)
+// on the center line, level with the windows
+{
+    std::array<Window, 4> windows = Windows(fence);
 
-            wall.Translate(Vector(0, fence.Height() / 2 - wall.Height() / 2));
-            i++;
-        });
+    return {X(Vector(fence.Center().X(), windows.front().Center().Y()), size),
+            X(Vector(fence.Center().X(), windows.back().Center().Y()), size)};
+}
 
-        std::for_each(walls.begin(), walls.begin() + 2, [](Wall &wall) {
-            wall.Translate(Vector(0, -wall.Height() * 2));
-        });
+constexpr std::array<Tree, 4> Trees(const Rectangle &fence)
+// two at the top of the center line, mirrored to the bottom
+{
+    Tree first = Tree(fence.Center(), size);
+    Tree second = Tree(fence.Center(), size);
 
-        std::for_each(walls.end() - 2, walls.end(), [](Wall &wall) {
-            wall.Translate(Vector(0, wall.Height() * 2));
-        });
+    first.Translate(Vector(0, -fence.Height() * 0.5f + size * 0.5f));
+    second.Translate(Vector(0, -fence.Height() * 0.5f + size * 1.5f));
 
-        // walls.insert(walls.end(), corners.begin(), corners.end());
+    return {first, second, first.Mirror_x(fence.Center()), second.Mirror_x(fence.Center())};
+}
 
-        // std::transform(corners.begin(), corners.end(), corners.begin(), [&](const Wall &corner) {
-        //     return corner.Mirror_x(fence.Center());
-        // });
-        // walls.insert(walls.end(), corners.begin(), corners.end());
+constexpr Layout Make_layout(const Rectangle &fence)
+{
+    return {Walls(fence), Windows(fence), Xs(fence), Trees(fence)};
+}
 
-        // std::transform(corners.begin(), corners.end(), corners.begin(), [&](const Wall &wall) {
-        //     return wall.Mirror_y(fence.Center());
-        // });
-        // walls.insert(walls.end(), corners.begin(), corners.end());
+constexpr Rectangle default_fence = Fence::Shape_for(Vector(param::window_width, param::window_height));
+constexpr Layout default_layout = Make_layout(default_fence);
 
-        // std::transform(corners.begin(), corners.end(), corners.begin(), [&](const Wall &wall) {
-        //     return wall.Mirror_x(fence.Center());
-        // });
-        // walls.insert(walls.end(), corners.begin(), corners.end());
-    }
+// same numbers as maps/map_1.txt
+static_assert(default_layout.walls[5].Shape() == Rectangle(590, 390, 60, 60));
+static_assert(default_layout.windows[2].Shape().Start() == Vector(180, 330));
+static_assert(default_layout.xs[1].Center() == Vector(400, 360));
+static_assert(default_layout.trees[2].Center() == Vector(400, 560));
+}; // namespace map_1
 
-    void arrange_windows()
+class Map_1 : public Map
+{
+public:
+    Map_1(const Fence &fence)
+        : Map{fence}
     {
-        std::for_each(windows.begin(), windows.end(), [&, i = 0](Window &window) mutable {
-            if (i % 2 == 0)
-                window.Translate(Vector(fence.Width() / 4 - walls.front().Width() / 2, 0));
-            else
-                window.Translate(Vector(fence.Width() * 3 / 4 + walls.front().Width() / 2, 0));
-
-            window.Translate(Vector(0, fence.Height() / 2 - window.Length() / 2));
+        // any other world size gets its layout at runtime, stored in place
+        if (!(fence.Shape() == map_1::default_fence))
+            custom_layout = map_1::Make_layout(fence.Shape());
 
-            i++;
-        });
-
-        std::for_each(windows.begin(), windows.begin() + 2, [](Window &window) {
-            window.Translate(Vector(0, -window.Length()));
-        });
+        const map_1::Layout &layout = custom_layout ? *custom_layout : map_1::default_layout;
 
-        std::for_each(windows.end() - 2, windows.end(), [](Window &window) {
-            window.Translate(Vector(0, window.Length()));
-        });
+        Place(layout.walls, layout.windows, layout.xs, layout.trees);
     }
 
-    void arrange_xs()
-    {
-        // std::for_each(xs.begin(), xs.end(), [&](X &x) {
-        //     x.Translate(Vector(fence.Width() / 2, fence.Height() / 2));
-        // });
+private:
+    std::optional<map_1::Layout> custom_layout;
+};
 
-        // std::array<int, 4> widths{1, -1, -1, 1};
-        // std::array<int, 4> heights{-1, -1, 1, 1};
+class Loaded_map : public Map
+// a compiled or generated map; walls and windows are its records, used where they lie,
+// while xs and trees are built once, their collision shapes are derived from the records
+{
+public:
+    Loaded_map(const Fence &fence, map_file::Mapped_file &&mapped_file)
+        : Map{fence}
+        , file{std::move(mapped_file)}
+    {
+        const map_file::Header &head = file.Head();
 
-        // for (int i = 0; i < 4; i++) {
-        //     xs.at(i + 1).Translate(
-        //         Vector((fence.Width() / 8 - xs.at(i).Size() / 2) * widths.at(i),
-        //                (fence.Width() / 8 - xs.at(i).Size() / 2) * heights.at(i)));
-        // }
+        Build(file.Xs(), head.x_count);
+        Build(file.Trees(), head.tree_count);
 
-        xs.front().Translate(Vector(param::window_width / 2, windows.front().Center().Y()));
-        xs.back().Translate(Vector(param::window_width / 2, windows.back().Center().Y()));
+        Place(View<Wall>(As_walls(file.Walls()), head.wall_count),
+              View<Window>(As_windows(file.Windows()), head.window_count),
+              xs,
+              trees);
     }
 
-    void arrange_trees()
+    Loaded_map(const Fence &fence, map_file::Map_data generated)
+        : Map{fence}
+        , map_data{std::move(generated)}
     {
-        // std::for_each(trees.begin(), trees.end(), [&](Tree &tree) {
-        //     tree.Translate(Vector(0, fence.Height() / 2 - tree.Diameter() / 2));
-        // });
+        Build(map_data.xs.data(), map_data.xs.size());
+        Build(map_data.trees.data(), map_data.trees.size());
 
-        // std::array<float, 5> xs{1, 0.5f, 0, -0.5f, -1};
-        // std::array<float, 5> ys{0, -0.5f, -1, -0.5f, 0};
+        Place(View<Wall>(As_walls(map_data.walls.data()), map_data.walls.size()),
+              View<Window>(As_windows(map_data.windows.data()), map_data.windows.size()),
+              xs,
+              trees);
+    }
 
-        // std::for_each(trees.begin() + 1, trees.end(), [&, i = 0](Tree &t) mutable {
-        //     t.Translate(t.Diameter() * xs.at(i), t.Diameter() * ys.at(i) * param::sqrt_3);
+private:
+    static const Wall *As_walls(const map_file::Wall_record *records)
+    // the layouts match, see the static_assert by Window; Open and Parse_text make sure no
+    // size is negative, which the Wall constructor would otherwise have fixed
+    {
+        return reinterpret_cast<const Wall *>(records);
+    }
 
-        //     i++;
-        // });
+    static const Window *As_windows(const map_file::Window_record *records)
+    {
+        return reinterpret_cast<const Window *>(records);
+    }
 
-        trees.front().Translate(Vector(0, -fence.Height() * 0.5f + trees.front().Diameter() * 0.5f));
-        trees.back().Translate(Vector(0, -fence.Height() * 0.5f + trees.back().Diameter() * 1.5f));
+    void Build(const map_file::X_record *records, std::size_t count)
+    {
+        xs.reserve(count);
 
-        std::vector<Tree> temp = trees;
+        for (const auto *r = records; r != records + count; ++r)
+            xs.emplace_back(Vector(r->x, r->y), r->size);
+    }
 
-        std::transform(temp.begin(), temp.end(), temp.begin(), [&](const Tree &t) {
-            return t.Mirror_x(fence.Center());
-        });
+    void Build(const map_file::Tree_record *records, std::size_t count)
+    {
+        trees.reserve(count);
 
-        trees.insert(trees.end(), temp.begin(), temp.end());
+        for (const auto *r = records; r != records + count; ++r)
+            trees.emplace_back(Vector(r->x, r->y), r->diameter);
     }
+
+    map_file::Mapped_file file; // owns the records of a compiled map
+    map_file::Map_data map_data; // or those of a generated one
+    std::vector<X> xs;
+    std::vector<Tree> trees;
 };
@@ -0,0 +1,73 @@
+#include "map_file.hpp"
+#include <chrono>
+#include <iostream>
+
+// map_compiler <source.txt> <output.mfgm>
+//     compile a text map into the binary format loaded by `my_first_game --map`
+// map_compiler --check <compiled.mfgm>
+//     map a compiled map and report its contents and load time
+
+int Compile(const std::string &source_path, const std::string &output_path)
+{
+    std::ifstream source{source_path};
+
+    if (!source) {
+        std::cerr << "cannot open " << source_path << '\n';
+        return 1;
+    }
+
+    map_file::Map_data map_data;
+    std::string error;
+
+    if (!map_file::Parse_text(source, map_data, error)) {
+        std::cerr << source_path << ": " << error << '\n';
+        return 1;
+    }
+
+    if (!map_file::Write_binary(output_path, map_data)) {
+        std::cerr << "cannot write " << output_path << '\n';
+        return 1;
+    }
+
+    std::cout << output_path << ": " << map_data.walls.size() << " walls, "
+              << map_data.windows.size() << " windows, " << map_data.xs.size() << " xs, "
+              << map_data.trees.size() << " trees\n";
+
+    return 0;
+}
+
+int Check(const std::string &path)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    map_file::Mapped_file file;
+    std::string error;
+
+    if (!file.Open(path, error)) {
+        std::cerr << error << '\n';
+        return 1;
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << path << ": version " << file.Head().version << ", " << file.Head().wall_count
+              << " walls, " << file.Head().window_count << " windows, " << file.Head().x_count
+              << " xs, " << file.Head().tree_count << " trees, mapped in " << elapsed.count()
+              << " ms\n";
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && std::string(argv[1]) == "--check")
+        return Check(argv[2]);
+
+    if (argc == 3)
+        return Compile(argv[1], argv[2]);
+
+    std::cerr << "usage: map_compiler <source.txt> <output.mfgm>\n"
+                 "       map_compiler --check <compiled.mfgm>\n";
+
+    return 1;
+}
@@ -0,0 +1,350 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#pragma once
+
+// Versioned binary map format.
+//
+// A compiled map is a header followed by flat float arrays in this order:
+// walls, windows, xs, trees. Every record is plain floats, so the file can be
+// memory-mapped and read in place without parsing: the game uses the wall and window
+// records as its obstacles where they lie. A wall's width and height are never negative.
+//
+// The text source form (compiled by map_compiler) is one obstacle per line,
+// coordinates are in world space:
+//
+//     # comment
+//     version 1
+//     wall   <x> <y> <width> <height>
+//     window <x1> <y1> <x2> <y2>
+//     x      <center x> <center y> <size>
+//     tree   <center x> <center y> <diameter>
+
+namespace map_file {
+const char magic[4] = {'M', 'F', 'G', 'M'};
+const std::uint32_t version = 1;
+
+struct Header
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t wall_count;
+    std::uint32_t window_count;
+    std::uint32_t x_count;
+    std::uint32_t tree_count;
+};
+
+struct Wall_record
+{
+    float x;
+    float y;
+    float width;
+    float height;
+};
+
+struct Window_record
+{
+    float x1;
+    float y1;
+    float x2;
+    float y2;
+};
+
+struct X_record
+{
+    float x;
+    float y;
+    float size;
+};
+
+struct Tree_record
+{
+    float x;
+    float y;
+    float diameter;
+};
+
+class Map_data
+{
+public:
+    std::vector<Wall_record> walls;
+    std::vector<Window_record> windows;
+    std::vector<X_record> xs;
+    std::vector<Tree_record> trees;
+
+    std::size_t Obstacle_count() const
+    {
+        return walls.size() + windows.size() + xs.size() + trees.size();
+    }
+};
+
+bool Parse_text(std::istream &input, Map_data &map_data, std::string &error);
+bool Write_text(std::ostream &output, const Map_data &map_data);
+bool Write_binary(const std::string &path, const Map_data &map_data);
+
+class Mapped_file
+// read only view of a compiled map, backed by mmap where available
+{
+public:
+    Mapped_file() = default;
+    ~Mapped_file() { Close(); }
+
+    Mapped_file(const Mapped_file &) = delete;
+    Mapped_file &operator=(const Mapped_file &) = delete;
+
+    Mapped_file(Mapped_file &&other) noexcept;
+
+    bool Open(const std::string &path, std::string &error);
+    void Close();
+
+    const Header &Head() const { return *reinterpret_cast<const Header *>(data); }
+
+    const Wall_record *Walls() const { return reinterpret_cast<const Wall_record *>(data + walls_offset); }
+
+    const Window_record *Windows() const
+    {
+        return reinterpret_cast<const Window_record *>(data + windows_offset);
+    }
+
+    const X_record *Xs() const { return reinterpret_cast<const X_record *>(data + xs_offset); }
+
+    const Tree_record *Trees() const { return reinterpret_cast<const Tree_record *>(data + trees_offset); }
+
+private:
+    const char *data = nullptr;
+    std::size_t size = 0;
+    std::size_t walls_offset = 0;
+    std::size_t windows_offset = 0;
+    std::size_t xs_offset = 0;
+    std::size_t trees_offset = 0;
+#ifdef _WIN32
+    std::vector<char> contents;
+#endif
+};
+}; // namespace map_file
+
+bool map_file::Parse_text(std::istream &input, Map_data &map_data, std::string &error)
+{
+    std::string line;
+    int line_number = 0;
+
+    while (std::getline(input, line)) {
+        line_number++;
+
+        std::size_t comment = line.find('#');
+
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream words{line};
+        std::string keyword;
+
+        if (!(words >> keyword))
+            continue;
+
+        bool ok = true;
+
+        if (keyword == "version") {
+            std::uint32_t text_version = 0;
+            ok = static_cast<bool>(words >> text_version);
+
+            if (ok && text_version != version) {
+                error = "line " + std::to_string(line_number) + ": unsupported version "
+                        + std::to_string(text_version);
+                return false;
+            }
+        } else if (keyword == "wall") {
+            Wall_record r{};
+            ok = words >> r.x >> r.y >> r.width >> r.height && r.width >= 0 && r.height >= 0;
+            map_data.walls.push_back(r);
+        } else if (keyword == "window") {
+            Window_record r{};
+            ok = static_cast<bool>(words >> r.x1 >> r.y1 >> r.x2 >> r.y2);
+            map_data.windows.push_back(r);
+        } else if (keyword == "x") {
+            X_record r{};
+            ok = static_cast<bool>(words >> r.x >> r.y >> r.size);
+            map_data.xs.push_back(r);
+        } else if (keyword == "tree") {
+            Tree_record r{};
+            ok = static_cast<bool>(words >> r.x >> r.y >> r.diameter);
+            map_data.trees.push_back(r);
+        } else {
+            error = "line " + std::to_string(line_number) + ": unknown keyword '" + keyword + "'";
+            return false;
+        }
+
+        if (!ok) {
+            error = "line " + std::to_string(line_number) + ": missing or invalid number";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool map_file::Write_text(std::ostream &output, const Map_data &map_data)
+{
+    output << "version " << version << '\n';
+
+    for (const Wall_record &r : map_data.walls)
+        output << "wall " << r.x << ' ' << r.y << ' ' << r.width << ' ' << r.height << '\n';
+
+    for (const Window_record &r : map_data.windows)
+        output << "window " << r.x1 << ' ' << r.y1 << ' ' << r.x2 << ' ' << r.y2 << '\n';
+
+    for (const X_record &r : map_data.xs)
+        output << "x " << r.x << ' ' << r.y << ' ' << r.size << '\n';
+
+    for (const Tree_record &r : map_data.trees)
+        output << "tree " << r.x << ' ' << r.y << ' ' << r.diameter << '\n';
+
+    return static_cast<bool>(output);
+}
+
+bool map_file::Write_binary(const std::string &path, const Map_data &map_data)
+{
+    std::ofstream output{path, std::ios::binary | std::ios::trunc};
+
+    if (!output)
+        return false;
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.wall_count = map_data.walls.size();
+    header.window_count = map_data.windows.size();
+    header.x_count = map_data.xs.size();
+    header.tree_count = map_data.trees.size();
+
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char *>(map_data.walls.data()),
+                 map_data.walls.size() * sizeof(Wall_record));
+    output.write(reinterpret_cast<const char *>(map_data.windows.data()),
+                 map_data.windows.size() * sizeof(Window_record));
+    output.write(reinterpret_cast<const char *>(map_data.xs.data()),
+                 map_data.xs.size() * sizeof(X_record));
+    output.write(reinterpret_cast<const char *>(map_data.trees.data()),
+                 map_data.trees.size() * sizeof(Tree_record));
+
+    return static_cast<bool>(output);
+}
+
+map_file::Mapped_file::Mapped_file(Mapped_file &&other) noexcept
+// the mapping changes owner, the records stay where they are
+    : data{std::exchange(other.data, nullptr)}
+    , size{std::exchange(other.size, 0)}
+    , walls_offset{other.walls_offset}
+    , windows_offset{other.windows_offset}
+    , xs_offset{other.xs_offset}
+    , trees_offset{other.trees_offset}
+#ifdef _WIN32
+    , contents{std::move(other.contents)}
+#endif
+{}
+
+bool map_file::Mapped_file::Open(const std::string &path, std::string &error)
+{
+    Close();
+
+#ifdef _WIN32
+    std::ifstream input{path, std::ios::binary};
+
+    if (!input) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    contents.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    data = contents.data();
+    size = contents.size();
+#else
+    int descriptor = open(path.c_str(), O_RDONLY);
+
+    if (descriptor < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    struct stat status;
+
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        close(descriptor);
+        error = "cannot read " + path;
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+
+    if (mapping == MAP_FAILED) {
+        error = "cannot map " + path;
+        return false;
+    }
+
+    data = static_cast<const char *>(mapping);
+    size = status.st_size;
+#endif
+
+    if (size < sizeof(Header) || std::memcmp(Head().magic, magic, sizeof(magic)) != 0) {
+        error = path + " is not a compiled map";
+        Close();
+        return false;
+    }
+
+    if (Head().version != version) {
+        error = path + " has unsupported version " + std::to_string(Head().version);
+        Close();
+        return false;
+    }
+
+    walls_offset = sizeof(Header);
+    windows_offset = walls_offset + Head().wall_count * sizeof(Wall_record);
+    xs_offset = windows_offset + Head().window_count * sizeof(Window_record);
+    trees_offset = xs_offset + Head().x_count * sizeof(X_record);
+
+    if (trees_offset + Head().tree_count * sizeof(Tree_record) != size) {
+        error = path + " is truncated or corrupt";
+        Close();
+        return false;
+    }
+
+    // read, not copied: the walls are used in place, as they are
+    for (const Wall_record *r = Walls(); r != Walls() + Head().wall_count; ++r) {
+        if (!(r->width >= 0 && r->height >= 0)) {
+            error = path + " has a wall of negative size";
+            Close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void map_file::Mapped_file::Close()
+{
+    if (data == nullptr)
+        return;
+
+#ifdef _WIN32
+    contents.clear();
+#else
+    munmap(const_cast<char *>(data), size);
+#endif
+
+    data = nullptr;
+    size = 0;
+}
@@ -0,0 +1,174 @@
+#include "geometry.hpp"
+#include "grid.hpp"
+#include "map_file.hpp"
+#include "param.hpp"
+#include <algorithm>
+#include <cstdint>
+#pragma once
+
+// Seeded generator for fair, mirror-symmetric maps of any density.
+//
+// Obstacles are placed in the top-left quarter of the fence and mirrored into the
+// other three quarters, so both kings (left and right) see the same layout.
+// Candidates that come closer than one pawn to an already placed obstacle, or that
+// sit in front of a throne, are rejected; the overlap test goes through a
+// Uniform_grid so generation stays near-linear in the obstacle count.
+
+class Random
+// splitmix64, same sequence on every compiler and platform
+{
+public:
+    Random(std::uint64_t seed)
+        : state{seed}
+    {}
+
+    std::uint64_t Next()
+    {
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    float Uniform(float min, float max)
+    {
+        return min + (max - min) * static_cast<float>(Next() >> 40) / static_cast<float>(1 << 24);
+    }
+
+    int Uniform(int min, int max) { return min + static_cast<int>(Next() % (max - min + 1)); }
+
+private:
+    std::uint64_t state;
+};
+
+class Map_generator
+{
+public:
+    Map_generator(const Rectangle &fence, std::uint64_t seed)
+        : fence{fence}
+        , random{seed}
+        , clearance{param::unit_length}
+        , max_size{param::unit_length * 6}
+        , quarter{fence.Origin() + Vector(clearance, clearance),
+                  fence.Size() / 2 - Vector(clearance, clearance) * 1.5f}
+        , throne_area{fence.Origin().X(),
+                      fence.Center().Y() - param::unit_length * 8,
+                      param::unit_length * 12,
+                      param::unit_length * 8}
+        , grid{quarter, max_size + clearance}
+    {}
+
+    map_file::Map_data Generate(int obstacle_count);
+
+private:
+    enum Kind { wall, window, x, tree };
+
+    bool Free(const Rectangle &bounds) const;
+    void Add_mirrored(map_file::Map_data &map_data, Kind kind, const Rectangle &bounds) const;
+    Rectangle Inflate(const Rectangle &bounds) const
+    {
+        return Rectangle(bounds.Origin() - Vector(clearance, clearance),
+                         bounds.Size() + Vector(clearance, clearance) * 2);
+    }
+
+    Rectangle fence;
+    Random random;
+    float clearance;
+    float max_size;
+    Rectangle quarter;
+    Rectangle throne_area; // in front of the left throne, the mirror keeps the right one free
+    Uniform_grid grid;
+    std::vector<Rectangle> placed;
+};
+
+map_file::Map_data Map_generator::Generate(int obstacle_count)
+// obstacle_count is the total over all four quarters
+{
+    grid.Clear();
+    placed.clear();
+
+    map_file::Map_data map_data;
+    int wanted = std::max(0, obstacle_count / 4);
+    std::int64_t attempts = std::int64_t{wanted} * 20 + 100; // no overflow for any int
+
+    for (std::int64_t attempt = 0; attempt < attempts && static_cast<int>(placed.size()) < wanted;
+         attempt++) {
+        Kind kind = static_cast<Kind>(random.Uniform(0, 3));
+        float size = random.Uniform(param::unit_length * 3, max_size);
+
+        Vector size_2d = kind == window
+                             ? (random.Uniform(0, 1) ? Vector(size, 0) : Vector(0, size))
+                             : Vector(size, size);
+
+        Vector origin = Vector(random.Uniform(quarter.Origin().X(),
+                                              quarter.Origin().X() + quarter.Width() - size_2d.X()),
+                               random.Uniform(quarter.Origin().Y(),
+                                              quarter.Origin().Y() + quarter.Height() - size_2d.Y()));
+
+        Rectangle bounds = Rectangle(origin, size_2d);
+
+        if (!quarter.Contain(origin + size_2d) || Overlap(Inflate(bounds), throne_area)
+            || !Free(bounds))
+            continue;
+
+        grid.Insert(placed.size(), bounds);
+        placed.push_back(bounds);
+        Add_mirrored(map_data, kind, bounds);
+    }
+
+    return map_data;
+}
+
+bool Map_generator::Free(const Rectangle &bounds) const
+{
+    bool free = true;
+    Rectangle inflated = Inflate(bounds);
+
+    grid.Query(inflated, [&](std::uint32_t id) {
+        if (Overlap(inflated, placed[id]))
+            free = false;
+    });
+
+    return free;
+}
+
+void Map_generator::Add_mirrored(map_file::Map_data &map_data,
+                                 Kind kind,
+                                 const Rectangle &bounds) const
+{
+    Vector center = fence.Center();
+
+    Rectangle rectangles[4] = {bounds,
+                               bounds.Mirror_y(center),
+                               bounds.Mirror_x(center),
+                               bounds.Mirror_x(center).Mirror_y(center)};
+
+    Line line = Line(bounds.Origin(), bounds.Origin() + bounds.Size());
+    Line lines[4] = {line,
+                     line.Mirror_y(center),
+                     line.Mirror_x(center),
+                     line.Mirror_x(center).Mirror_y(center)};
+
+    for (int i = 0; i < 4; i++) {
+        const Rectangle &r = rectangles[i];
+
+        switch (kind) {
+        case wall:
+            map_data.walls.push_back({r.Origin().X(), r.Origin().Y(), r.Width(), r.Height()});
+            break;
+
+        case window:
+            map_data.windows.push_back(
+                {lines[i].Start().X(), lines[i].Start().Y(), lines[i].End().X(), lines[i].End().Y()});
+            break;
+
+        case x:
+            map_data.xs.push_back({r.Center().X(), r.Center().Y(), r.Width()});
+            break;
+
+        case tree:
+            map_data.trees.push_back({r.Center().X(), r.Center().Y(), r.Width()});
+            break;
+        }
+    }
+}
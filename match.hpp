@@ -0,0 +1,520 @@
+#include "alloc.hpp"
+#include "character.hpp"
+#include "map.hpp"
+#include "map_generator.hpp"
+#include "object.hpp"
+#include "option.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+#pragma once
+
+// The rules of the game without window, input or drawing.
+//
+// A match only changes through Fire and Step, and both are deterministic, so two
+// processes that apply the same turns in the same order end up in the same state.
+// That is what the lockstep network mode relies on: only turns travel, every side
+// simulates the shots itself and compares Hash values to notice a desync.
+//
+// Two to param::max_teams teams take turns, each team that still has a life in
+// order. Every team's pawns live in one vector and one Pawn_index, so a shot looks
+// for victims in a single grid query whatever the number of teams.
+
+struct Turn
+// everything a player decides in one turn, in world coordinates
+{
+    Vector origin{0, 0};      // center of the active king or of one of the active team's pawns
+    Vector destination{0, 0}; // where the new pawn would stop if nothing is in the way
+};
+
+struct Vanished
+// a dead pawn or a lost life, gone from the match but left for the screen to fade out
+{
+    Circle shape;
+    ALLEGRO_COLOR color;
+    bool life; // a king's life rather than a pawn
+};
+
+class Match
+{
+public:
+    Match(const Option &option);
+
+    Match(const Match &) = delete;
+    Match &operator=(const Match &) = delete;
+
+    bool Can_fire(const Turn &turn) const;
+    void Fire(const Turn &turn);
+    void Step();
+    void Reset();
+
+    bool Shooting() const { return shooting; }
+    bool Over() const;
+    int Active_side() const { return active; }
+    int Team_count() const { return static_cast<int>(kings.size()); }
+    std::uint32_t Turn_count() const { return turn_count; }
+    std::uint64_t Hash() const;
+
+    const Vector &World_size() const { return world_size; }
+    static Vector Arena_size(const Option &option); // the World_size a match of option gets
+    const Fence &Boundary() const { return fence; }
+    const Map &Obstacles() const { return *map; }
+    const King &King_of(int team) const { return kings[team]; }
+    const King &Active_king() const { return kings[active]; }
+    const std::vector<King> &Kings() const { return kings; }
+    const std::vector<Pawn> &Pawns() const { return pawns; }
+    const Pawn_index &Index() const { return index; }
+    // the pawn of the shot on its way, which Index still has where it was fired from
+    const Pawn *Shot_pawn() const { return shooting && shot_pawn_last ? &pawns.back() : nullptr; }
+    const std::vector<Vanished> &Vanished_in_last_step() const { return vanished; }
+
+private:
+    void Move_pawn();
+    void Clean_pawn();
+    void Retire_vanishing();
+    int Next_team() const;
+    static std::vector<King> Make_kings(int team_count, const Vector &world_size);
+    static std::unique_ptr<Map> Make_map(const Option &option,
+                                         const Fence &fence,
+                                         const std::vector<King> &kings);
+    static std::unique_ptr<Map> Make_free_for_all_map(const Option &option,
+                                                      const Fence &fence,
+                                                      const std::vector<King> &kings);
+
+    Vector world_size;
+    Fence fence;
+    std::vector<King> kings; // one per team
+    std::vector<Pawn> pawns; // every team's, the one being shot last
+    Pawn_index index;
+    int active;              // team to play
+    int dying;               // pawns marked by the last Move_pawn
+    bool shot_pawn_last;     // the shot pawn is still pawns.back(), neither vanished nor dead
+    std::vector<Vanished> vanished;
+
+    Shot shot;
+    Vector spawn_position; // origin of the turn being shot
+    bool shooting;
+    std::uint32_t turn_count;
+
+    std::unique_ptr<Map> map;
+};
+
+Turn Random_turn(const Match &match, Random &random);
+
+Match::Match(const Option &option)
+    : world_size{Arena_size(option)}
+    , fence{world_size}
+    , kings{Make_kings(option.Team_count(), world_size)}
+    , index{fence.Shape(), pawns}
+    , active{0}
+    , dying{0}
+    , shot_pawn_last{false}
+    , spawn_position{0, 0}
+    , shooting{false}
+    , turn_count{0}
+    , map{Make_map(option, fence, kings)}
+{}
+
+bool Match::Can_fire(const Turn &turn) const
+// a turn starts from the active king or from one of the active team's pawns, and is
+// aimed at the reach circle around it like every turn the game makes; a turn from the
+// network is checked with this before it is fired
+{
+    if (shooting || Over())
+        return false;
+
+    if (!std::isfinite(turn.origin.X()) || !std::isfinite(turn.origin.Y())
+        || !std::isfinite(turn.destination.X()) || !std::isfinite(turn.destination.Y()))
+        return false;
+
+    // a turn is aimed through Vector::Unit or cosf/sinf, so its length is off by a
+    // rounding error at most
+    float reach = sqrtf((turn.destination - turn.origin).Magsq());
+
+    if (!Equal(reach, param::reach_radius, param::reach_radius / 1000))
+        return false;
+
+    if (turn.origin == Active_king().Center())
+        return true;
+
+    // once per turn, so a plain scan; pawns of one team may overlap, which Find would hide
+    return std::any_of(pawns.begin(), pawns.end(), [&](const Pawn &pawn) {
+        return pawn.Team() == active && pawn.Center() == turn.origin;
+    });
+}
+
+void Match::Fire(const Turn &turn)
+// call only when Can_fire(turn)
+{
+    pawns.emplace_back(turn.origin, active);
+    index.Add_last();
+    shot_pawn_last = true;
+    trace::Instant("Pawn_spawn", "pawn");
+
+    spawn_position = turn.origin;
+    shot.Start(turn.origin, turn.destination);
+
+    shooting = true;
+    turn_count++;
+}
+
+void Match::Step()
+// one timer tick, does nothing unless a shot is on its way
+{
+    vanished.clear();
+
+    if (!shooting)
+        return;
+
+    // once stopped, the shot pawn may already be popped, so there is nothing to move
+    if (!shot.Finish_moving())
+        Move_pawn();
+
+    Clean_pawn();
+}
+
+void Match::Reset()
+{
+    for (King &king : kings)
+        king.Reset_life();
+
+    pawns.clear();
+    index.Rebuild();
+
+    active = 0;
+    dying = 0;
+    shot_pawn_last = false;
+    vanished.clear();
+
+    shot = Shot();
+    shooting = false;
+    turn_count = 0;
+}
+
+bool Match::Over() const
+// when at most one team still has a life, that team is the active one
+{
+    return std::count_if(kings.begin(), kings.end(), [](const King &king) { return king.Life() > 0; })
+           <= 1;
+}
+
+std::uint64_t Match::Hash() const
+// FNV-1a over everything a turn can change: lives, the team to play, every pawn position
+{
+    std::uint64_t hash = 0xCBF29CE484222325ull;
+
+    auto add = [&](std::uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 0x100000001B3ull;
+        }
+    };
+
+    auto add_float = [&](float value) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        add(bits);
+    };
+
+    add(turn_count);
+    add(shooting);
+    add(Active_side());
+
+    for (const King &king : kings)
+        add(king.Life());
+
+    // team by team, as the teams' pawns were once stored apart
+    for (int team = 0; team < Team_count(); team++) {
+        add(static_cast<std::uint32_t>(std::count_if(pawns.begin(), pawns.end(), [&](const Pawn &pawn) {
+            return pawn.Team() == team;
+        })));
+
+        for (const Pawn &pawn : pawns) {
+            if (pawn.Team() != team)
+                continue;
+
+            add_float(pawn.Center().X());
+            add_float(pawn.Center().Y());
+        }
+    }
+
+    return hash;
+}
+
+void Match::Move_pawn()
+{
+    trace::Scope scope{"Move_pawn", "simulation"};
+
+    Pawn &moving_pawn = pawns.back();
+
+    moving_pawn.Move(shot);
+
+    alloc::Scope tag{alloc::Tag::collision};
+
+    {
+        trace::Scope scope{"Pawn::Kill", "collision"};
+        dying += moving_pawn.Kill(pawns, index, shot);
+    }
+    {
+        trace::Scope scope{"Pawn::Stopped_by", "collision"};
+        moving_pawn.Stopped_by(kings[active], spawn_position, shot);
+    }
+    {
+        trace::Scope scope{"Pawn::Hurt", "collision"};
+
+        for (int team = 0; team < Team_count(); team++)
+            if (team != active)
+                moving_pawn.Hurt(kings[team], shot);
+    }
+    {
+        trace::Scope scope{"Map::Wall_stop", "collision"};
+        map->Wall_stop(moving_pawn, shot);
+    }
+    {
+        trace::Scope scope{"Map::Tree_stop", "collision"};
+        map->Tree_stop(moving_pawn, shot);
+    }
+    {
+        trace::Scope scope{"Map::X_kill", "collision"};
+        map->X_kill(moving_pawn, shot);
+    }
+    {
+        trace::Scope scope{"Map::Window_only_shoot", "collision"};
+        map->Window_only_shoot(moving_pawn, shot);
+    }
+    {
+        trace::Scope scope{"Fence::Kill", "collision"};
+        fence.Kill(moving_pawn, shot);
+    }
+}
+
+void Match::Clean_pawn()
+{
+    trace::Scope scope{"Clean_pawn", "simulation"};
+
+    if (shot.Vanish_immediately() && shot.Finish_moving()) {
+        index.Remove_last();
+        pawns.pop_back();
+        shot_pawn_last = false;
+        trace::Instant("Pawn_vanish_immediately", "pawn");
+        shot.Vanish_immediately(false);
+    }
+
+    Retire_vanishing();
+
+    if (!shot.Finish_moving())
+        return;
+
+    if (shot_pawn_last)
+        index.Update_last();
+
+    shot_pawn_last = false;
+
+    for (King &king : kings) {
+        int life = king.Life();
+        king.Update_life();
+
+        if (king.Life() < life)
+            vanished.push_back({king.Life_shape(king.Life()), king.Color(), true});
+    }
+
+    shooting = false;
+
+    if (!Over())
+        active = Next_team();
+}
+
+void Match::Retire_vanishing()
+// the shot pawn only dies by being stopped, so it is the last pawn and moves no more;
+// the ones it killed are compacted in one pass, which reindexes every pawn
+{
+    if (shot_pawn_last && pawns.back().Dying()) {
+        const Pawn &pawn = pawns.back();
+
+        vanished.push_back({pawn.Shape(), pawn.Color(), false});
+        trace::Instant("Pawn_death", "pawn");
+        index.Remove_last();
+        pawns.pop_back();
+        shot_pawn_last = false;
+    }
+
+    if (dying == 0)
+        return;
+
+    for (const Pawn &pawn : pawns) {
+        if (pawn.Dying()) {
+            vanished.push_back({pawn.Shape(), pawn.Color(), false});
+            trace::Instant("Pawn_death", "pawn");
+        }
+    }
+
+    pawns.erase(std::remove_if(pawns.begin(), pawns.end(), [](const Pawn &pawn) { return pawn.Dying(); }),
+                pawns.end());
+    index.Rebuild();
+    dying = 0;
+}
+
+int Match::Next_team() const
+// the next team round the table that still has a life
+{
+    int team = active;
+
+    do
+        team = (team + 1) % Team_count();
+    while (kings[team].Life() == 0 && team != active);
+
+    return team;
+}
+
+Turn Random_turn(const Match &match, Random &random)
+// from the king or a random pawn of the active team, in a random direction; for the
+// tools that play matches without players
+{
+    const std::vector<Pawn> &pawns = match.Pawns();
+    int team = match.Active_side();
+    int count = static_cast<int>(std::count_if(pawns.begin(), pawns.end(), [&](const Pawn &pawn) {
+        return pawn.Team() == team;
+    }));
+    int choice = random.Uniform(0, count);
+    Vector origin = match.Active_king().Center();
+
+    for (const Pawn &pawn : pawns) {
+        if (choice == 0)
+            break;
+
+        if (pawn.Team() == team && --choice == 0)
+            origin = pawn.Center();
+    }
+
+    float angle = random.Uniform(0.f, 2 * param::pi);
+
+    return {origin, origin + Vector(cosf(angle), sinf(angle)) * param::reach_radius};
+}
+
+Vector Match::Arena_size(const Option &option)
+// more teams need more room, the area grows with the team count
+{
+    float scale = option.World_scale();
+
+    if (option.Team_count() > 2)
+        scale = std::max(scale, sqrtf(option.Team_count() / 2.f));
+
+    return Vector(param::window_width, param::window_height) * scale;
+}
+
+std::vector<King> Match::Make_kings(int team_count, const Vector &world_size)
+{
+    std::vector<King> kings;
+    kings.reserve(team_count);
+
+    for (int team = 0; team < team_count; team++)
+        kings.push_back(Team_king(team, team_count, world_size));
+
+    return kings;
+}
+
+std::unique_ptr<Map> Match::Make_map(const Option &option,
+                                      const Fence &fence,
+                                      const std::vector<King> &kings)
+{
+    if (kings.size() > 2)
+        return Make_free_for_all_map(option, fence, kings);
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (option.Generate()) {
+        Map_generator generator = Map_generator(fence.Shape(), option.Seed());
+        auto generated_map = std::make_unique<Loaded_map>(fence,
+                                                          generator.Generate(option.Obstacle_count()));
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::clog << "generated map with seed " << option.Seed() << " in " << elapsed.count()
+                  << " ms\n";
+
+        return generated_map;
+    }
+
+    if (option.Map_path().empty())
+        return std::make_unique<Map_1>(fence);
+
+    map_file::Mapped_file file;
+    std::string error;
+
+    if (!file.Open(option.Map_path(), error)) {
+        std::cerr << error << ", falling back to the built-in map\n";
+        return std::make_unique<Map_1>(fence);
+    }
+
+    auto loaded_map = std::make_unique<Loaded_map>(fence, std::move(file));
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::clog << "loaded " << option.Map_path() << " in " << elapsed.count() << " ms\n";
+
+    return loaded_map;
+}
+
+std::unique_ptr<Map> Match::Make_free_for_all_map(const Option &option,
+                                                  const Fence &fence,
+                                                  const std::vector<King> &kings)
+// the built-in map is laid out for two thrones, so free for all plays on the --map
+// file or on a generated map, without whatever stands on or right in front of a throne
+{
+    map_file::Map_data map_data;
+    map_file::Mapped_file file;
+    std::string error;
+
+    if (!option.Map_path().empty() && file.Open(option.Map_path(), error)) {
+        const auto &head = file.Head();
+        map_data.walls.assign(file.Walls(), file.Walls() + head.wall_count);
+        map_data.windows.assign(file.Windows(), file.Windows() + head.window_count);
+        map_data.xs.assign(file.Xs(), file.Xs() + head.x_count);
+        map_data.trees.assign(file.Trees(), file.Trees() + head.tree_count);
+    } else {
+        if (!error.empty())
+            std::cerr << error << ", generating a map instead\n";
+
+        map_data = Map_generator(fence.Shape(), option.Seed()).Generate(option.Obstacle_count());
+    }
+
+    std::vector<Rectangle> keep_out;
+    const Vector margin = Vector(param::unit_length, param::unit_length) * 4;
+
+    for (const King &king : kings) {
+        const Rectangle &throne = king.Throne_shape();
+        keep_out.push_back(Rectangle(throne.Origin() - margin, throne.Size() + margin * 2));
+    }
+
+    auto near_throne = [&](const Rectangle &bounds) {
+        return std::any_of(keep_out.begin(), keep_out.end(), [&](const Rectangle &area) {
+            return Overlap(bounds, area);
+        });
+    };
+
+    auto square = [](float x, float y, float size) {
+        return Rectangle(x - size / 2, y - size / 2, size, size);
+    };
+
+    auto clear = [&](auto &records, auto bounds) {
+        records.erase(std::remove_if(records.begin(),
+                                     records.end(),
+                                     [&](const auto &r) { return near_throne(bounds(r)); }),
+                      records.end());
+    };
+
+    clear(map_data.walls, [](const map_file::Wall_record &r) {
+        return Rectangle(r.x, r.y, r.width, r.height);
+    });
+    clear(map_data.windows, [](const map_file::Window_record &r) {
+        return Rectangle(std::min(r.x1, r.x2), std::min(r.y1, r.y2), fabsf(r.x2 - r.x1), fabsf(r.y2 - r.y1));
+    });
+    clear(map_data.xs, [&](const map_file::X_record &r) { return square(r.x, r.y, r.size); });
+    clear(map_data.trees, [&](const map_file::Tree_record &r) { return square(r.x, r.y, r.diameter); });
+
+    return std::make_unique<Loaded_map>(fence, std::move(map_data));
+}
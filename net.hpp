@@ -0,0 +1,347 @@
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <utility>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#pragma once
+
+// Minimal TCP: a listener accepts connections, the other side connects. Send blocks
+// until everything is written, Receive can poll so the game loop never waits on the
+// network. A connection switched to non-blocking uses Send_some instead, for servers
+// that must not stall on one slow client.
+
+namespace net {
+#ifdef _WIN32
+using Socket = SOCKET;
+const Socket invalid_socket = INVALID_SOCKET;
+#else
+using Socket = int;
+const Socket invalid_socket = -1;
+#endif
+
+class Connection
+{
+public:
+    Connection() = default;
+    ~Connection() { Close(); }
+
+    Connection(const Connection &) = delete;
+    Connection &operator=(const Connection &) = delete;
+
+    Connection(Connection &&other)
+        : socket{std::exchange(other.socket, invalid_socket)}
+    {}
+
+    Connection &operator=(Connection &&other)
+    {
+        Close();
+        socket = std::exchange(other.socket, invalid_socket);
+        return *this;
+    }
+
+    bool Connect(const std::string &host, int port, std::string &error);
+    bool Send(const void *data, std::size_t size);
+    int Send_some(const void *data, std::size_t size);
+    int Receive(void *data, std::size_t size, int timeout_ms);
+    bool Blocking(bool blocking);
+    bool Open() const { return socket != invalid_socket; }
+    void Close();
+
+private:
+    friend class Listener;
+
+    void Adopt(Socket accepted);
+
+    Socket socket = invalid_socket;
+};
+
+class Listener
+{
+public:
+    Listener() = default;
+    ~Listener() { Close(); }
+
+    Listener(const Listener &) = delete;
+    Listener &operator=(const Listener &) = delete;
+
+    bool Open(int port, std::string &error);
+    int Port() const { return port; }
+    bool Accept(Connection &connection, std::string &error);
+    bool Poll(Connection &connection, int timeout_ms);
+    void Close();
+
+private:
+    Socket socket = invalid_socket;
+    int port = 0;
+};
+
+bool Startup();
+void Close_socket(Socket socket);
+}; // namespace net
+
+bool net::Startup()
+// winsock needs one WSAStartup per process, elsewhere there is nothing to do
+{
+#ifdef _WIN32
+    static bool started = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+
+    return started;
+#else
+    return true;
+#endif
+}
+
+void net::Close_socket(Socket socket)
+{
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+bool net::Connection::Connect(const std::string &host, int port, std::string &error)
+{
+    Close();
+
+    if (!Startup()) {
+        error = "cannot start networking";
+        return false;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *addresses = nullptr;
+
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+        error = "cannot resolve " + host;
+        return false;
+    }
+
+    for (addrinfo *address = addresses; address != nullptr; address = address->ai_next) {
+        Socket candidate = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+
+        if (candidate == invalid_socket)
+            continue;
+
+        if (connect(candidate, address->ai_addr, static_cast<int>(address->ai_addrlen)) == 0) {
+            Adopt(candidate);
+            break;
+        }
+
+        Close_socket(candidate);
+    }
+
+    freeaddrinfo(addresses);
+
+    if (!Open()) {
+        error = "cannot connect to " + host + ":" + std::to_string(port);
+        return false;
+    }
+
+    return true;
+}
+
+bool net::Connection::Send(const void *data, std::size_t size)
+{
+    const char *bytes = static_cast<const char *>(data);
+
+    while (size > 0) {
+#ifdef _WIN32
+        int sent = send(socket, bytes, static_cast<int>(size), 0);
+#else
+        ssize_t sent = send(socket, bytes, size, MSG_NOSIGNAL);
+#endif
+
+        if (sent <= 0)
+            return false;
+
+        bytes += sent;
+        size -= sent;
+    }
+
+    return true;
+}
+
+int net::Connection::Send_some(const void *data, std::size_t size)
+// on a non-blocking connection: bytes written, 0 when the socket buffer is full, -1 on error
+{
+#ifdef _WIN32
+    int sent = send(socket, static_cast<const char *>(data), static_cast<int>(size), 0);
+
+    if (sent < 0)
+        return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -1;
+#else
+    ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+
+    if (sent < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+#endif
+
+    return static_cast<int>(sent);
+}
+
+bool net::Connection::Blocking(bool blocking)
+{
+#ifdef _WIN32
+    u_long mode = blocking ? 0 : 1;
+
+    return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+
+    if (flags < 0)
+        return false;
+
+    return fcntl(socket, F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK) == 0;
+#endif
+}
+
+int net::Connection::Receive(void *data, std::size_t size, int timeout_ms)
+// up to size bytes: 0 when nothing arrived within timeout_ms, -1 once the peer is gone
+{
+    pollfd descriptor{};
+    descriptor.fd = socket;
+    descriptor.events = POLLIN;
+
+#ifdef _WIN32
+    int ready = WSAPoll(&descriptor, 1, timeout_ms);
+#else
+    int ready = poll(&descriptor, 1, timeout_ms);
+#endif
+
+    if (ready < 0)
+        return -1;
+
+    if (ready == 0)
+        return 0;
+
+    int received = recv(socket, static_cast<char *>(data), static_cast<int>(size), 0);
+
+    return received > 0 ? received : -1;
+}
+
+void net::Connection::Close()
+{
+    if (socket == invalid_socket)
+        return;
+
+    Close_socket(socket);
+    socket = invalid_socket;
+}
+
+void net::Connection::Adopt(Socket accepted)
+{
+    Close();
+    socket = accepted;
+
+    // turns are a few bytes each, send them right away instead of batching
+    int no_delay = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&no_delay), sizeof(no_delay));
+}
+
+bool net::Listener::Open(int port, std::string &error)
+// port 0 picks a free port, Port() tells which
+{
+    Close();
+
+    if (!Startup()) {
+        error = "cannot start networking";
+        return false;
+    }
+
+    socket = ::socket(AF_INET, SOCK_STREAM, 0);
+
+    if (socket == invalid_socket) {
+        error = "cannot create a socket";
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&reuse), sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<unsigned short>(port));
+
+    if (bind(socket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+        || listen(socket, SOMAXCONN) != 0) {
+        error = "cannot listen on port " + std::to_string(port);
+        Close();
+        return false;
+    }
+
+    socklen_t length = sizeof(address);
+    getsockname(socket, reinterpret_cast<sockaddr *>(&address), &length);
+    this->port = ntohs(address.sin_port);
+
+    return true;
+}
+
+bool net::Listener::Accept(Connection &connection, std::string &error)
+// blocks until a peer connects
+{
+    Socket accepted = accept(socket, nullptr, nullptr);
+
+    if (accepted == invalid_socket) {
+        error = "cannot accept on port " + std::to_string(port);
+        return false;
+    }
+
+    connection.Adopt(accepted);
+
+    return true;
+}
+
+bool net::Listener::Poll(Connection &connection, int timeout_ms)
+// accept a peer if one is waiting within timeout_ms
+{
+    pollfd descriptor{};
+    descriptor.fd = socket;
+    descriptor.events = POLLIN;
+
+#ifdef _WIN32
+    int ready = WSAPoll(&descriptor, 1, timeout_ms);
+#else
+    int ready = poll(&descriptor, 1, timeout_ms);
+#endif
+
+    if (ready <= 0)
+        return false;
+
+    Socket accepted = accept(socket, nullptr, nullptr);
+
+    if (accepted == invalid_socket)
+        return false;
+
+    connection.Adopt(accepted);
+
+    return true;
+}
+
+void net::Listener::Close()
+{
+    if (socket == invalid_socket)
+        return;
+
+    Close_socket(socket);
+    socket = invalid_socket;
+}
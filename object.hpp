@@ -31,7 +31,7 @@ public:
     }
 
     void Center(const Vector &point) { reach_circle.Center(point); }
-    const Vector &Center() { return reach_circle.Center(); }
+    const Vector &Center() const { return reach_circle.Center(); }
 
     const Vector &Pawn_destination() const { return pawn_destination; }
 
@@ -45,13 +45,16 @@ public:
 
         Vector temp = direction_sign.Vertex_1() + unit * param::unit_length;
 
-        direction_sign.Vertex_2(temp
-                                + Matrix(0, 1, -1, 0) * unit * param::unit_length / param::sqrt_3);
+        Vector wing = unit.Perpendicular() * (param::unit_length / param::sqrt_3);
 
-        direction_sign.Vertex_3(temp
-                                + Matrix(0, -1, 1, 0) * unit * param::unit_length / param::sqrt_3);
+        direction_sign.Vertex_2(temp + wing);
+
+        direction_sign.Vertex_3(temp - wing);
     }
 
+    bool Visible() const { return reach_circle_is_visible; }
+    bool Direction_visible() const { return direction_sign_is_visible; }
+
     void Show_reach_circle() { reach_circle_is_visible = true; }
     void Show_direction_sign() { direction_sign_is_visible = true; }
     void Hide()
@@ -74,17 +77,11 @@ private:
 class Clipper
 {
 public:
-    Clipper()
-        : left{0, 0, 2 * param::unit_length, param::window_height}
-        , top{0, 0, param::window_width, param::unit_length}
-        , right{param::window_width - 2 * param::unit_length,
-                0,
-                2 * param::unit_length,
-                param::window_height}
-        , bottom{0,
-                 param::window_height - param::unit_length,
-                 param::window_width,
-                 param::unit_length}
+    Clipper(const Vector &world_size = Vector(param::window_width, param::window_height))
+        : left{0, 0, 2 * param::unit_length, world_size.Y()}
+        , top{0, 0, world_size.X(), param::unit_length}
+        , right{world_size.X() - 2 * param::unit_length, 0, 2 * param::unit_length, world_size.Y()}
+        , bottom{0, world_size.Y() - param::unit_length, world_size.X(), param::unit_length}
         , color{param::black} {};
 
     void Draw() const
@@ -106,14 +103,19 @@ private:
 class Fence
 {
 public:
-    Fence()
-        : shape{2 * param::unit_length,
-                param::unit_length,
-                param::window_width - 4 * param::unit_length,
-                param::window_height - 2 * param::unit_length}
+    Fence(const Vector &world_size = Vector(param::window_width, param::window_height))
+        : shape{Shape_for(world_size)}
         , color{param::red}
         , line_width{param::line_width * 2} {};
 
+    static constexpr Rectangle Shape_for(const Vector &world_size)
+    {
+        return Rectangle(2 * param::unit_length,
+                         param::unit_length,
+                         world_size.X() - 4 * param::unit_length,
+                         world_size.Y() - 2 * param::unit_length);
+    }
+
     void Draw() const { shape.Draw(color, line_width); };
 
     const Rectangle &Shape() const { return shape; }
@@ -126,18 +128,18 @@ public:
 
     float Height() const { return shape.Height(); }
 
-    void Kill(Pawn &moving_pawn, std::set<Pawn *> &dying_pawns) const
+    void Kill(Pawn &moving_pawn, Shot &shot) const
     {
         float t = collision::Circle_inside_rectangle(moving_pawn.Shape(),
                                                      shape,
-                                                     moving_pawn.Last_translation());
+                                                     moving_pawn.Last_translation(shot));
 
-        if (t == 2 || Pawn::Vanish_immediately())
+        if (t == 2 || shot.Vanish_immediately())
             return;
 
-        moving_pawn.Retreat(1 - t);
-        moving_pawn.Stop();
-        dying_pawns.insert(&moving_pawn);
+        moving_pawn.Retreat(1 - t, shot);
+        shot.Stop();
+        moving_pawn.Die();
     }
 
 private:
@@ -0,0 +1,185 @@
+#include "param.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#pragma once
+
+// my_first_game [--trace trace.json] [--capture capture.mfgc] [--map map.mfgm]
+//               [--script session.txt [--script-report report.txt]]
+//               [--generate seed] [--obstacles count] [--world-scale scale] [--teams count]
+//               [--host port | --join host:port] [--spectators port] [--telemetry name]
+//
+// --generate makes a random map of --obstacles obstacles, at most max_obstacle_count.
+// --world-scale multiplies the arena by 1 to max_world_scale in both directions.
+// --capture records every frame shown, losslessly, see capture.hpp.
+// --script plays a recorded session as fast as possible instead of waiting for input
+// and the timer, see script.hpp, and writes its report to --script-report or stdout.
+// --teams plays a free for all of up to 16 teams taking turns on one machine, in an
+// arena that grows with the team count.
+// --host and --join play against another machine: the host plays magenta and
+// starts, both sides need the same map and world options. --spectators streams the
+// match to any number of observers connecting to port. Both need two teams.
+// --telemetry publishes live counters in the POSIX shared memory object name, like
+// /my_first_game, for telemetry_reader or a dashboard, see telemetry.hpp.
+
+class Option
+{
+public:
+    static constexpr int max_obstacle_count = 65536;
+    static constexpr float max_world_scale = 16;
+
+    Option(int argc, char **argv)
+    {
+        for (int i = 1; i < argc; i++) {
+            std::string argument = argv[i];
+            bool has_value = i + 1 < argc;
+
+            if (argument == "--trace" && has_value)
+                trace_path = argv[++i];
+
+            else if (argument == "--capture" && has_value)
+                capture_path = argv[++i];
+
+            else if (argument == "--script" && has_value)
+                script_path = argv[++i];
+
+            else if (argument == "--script-report" && has_value)
+                script_report_path = argv[++i];
+
+            else if (argument == "--map" && has_value)
+                map_path = argv[++i];
+
+            else if (argument == "--generate" && has_value)
+                generate = Parse_number(argument, argv[++i], seed) || generate;
+
+            else if (argument == "--obstacles" && has_value)
+                Parse_number(argument, argv[++i], obstacle_count);
+
+            else if (argument == "--world-scale" && has_value)
+                Parse_number(argument, argv[++i], world_scale);
+
+            else if (argument == "--host" && has_value)
+                Parse_port(argument, argv[++i], host_port);
+
+            else if (argument == "--join" && has_value)
+                Parse_address(argv[++i]);
+
+            else if (argument == "--spectators" && has_value)
+                Parse_port(argument, argv[++i], spectator_port);
+
+            else if (argument == "--telemetry" && has_value)
+                telemetry_name = argv[++i];
+
+            else if (argument == "--teams" && has_value)
+                Parse_number(argument, argv[++i], team_count);
+
+            else
+                std::cerr << "ignoring unknown option " << argument << '\n';
+        }
+
+        obstacle_count = std::clamp(obstacle_count, 0, max_obstacle_count);
+        // from_chars takes inf and nan, which would size the world's grids from them
+        if (!std::isfinite(world_scale)) {
+            std::cerr << "ignoring --world-scale " << world_scale << ", expected a finite number\n";
+            world_scale = 1;
+        }
+
+        world_scale = std::clamp(world_scale, 1.f, max_world_scale);
+        team_count = std::clamp(team_count, 2, param::max_teams);
+
+        if (team_count > 2 && (Networked() || spectator_port != 0)) {
+            std::cerr << "ignoring --host, --join and --spectators, they need two teams\n";
+            host_port = 0;
+            join_host.clear();
+            spectator_port = 0;
+        }
+    }
+
+    const std::string &Trace_path() const { return trace_path; }
+    const std::string &Capture_path() const { return capture_path; }
+    const std::string &Script_path() const { return script_path; }
+    const std::string &Script_report_path() const { return script_report_path; }
+    const std::string &Map_path() const { return map_path; }
+    bool Generate() const { return generate; }
+    std::uint64_t Seed() const { return seed; }
+    int Obstacle_count() const { return obstacle_count; }
+    float World_scale() const { return world_scale; }
+    int Host_port() const { return host_port; }
+    const std::string &Join_host() const { return join_host; }
+    int Join_port() const { return join_port; }
+    bool Networked() const { return host_port != 0 || !join_host.empty(); }
+    int Spectator_port() const { return spectator_port; }
+    const std::string &Telemetry_name() const { return telemetry_name; }
+    int Team_count() const { return team_count; }
+
+    template <typename Number>
+    static bool Parse_number(std::string_view option, std::string_view text, Number &value)
+    // the whole of text as a number, else a warning and value is left as it was; for the
+    // tools' own options too
+    {
+        Number parsed{};
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+
+        if (error != std::errc{} || end != text.data() + text.size()) {
+            std::cerr << "ignoring " << option << ' ' << text << ", expected a number\n";
+            return false;
+        }
+
+        value = parsed;
+        return true;
+    }
+
+private:
+    void Parse_address(const std::string &address)
+    {
+        std::size_t colon = address.rfind(':');
+
+        if (colon == std::string::npos) {
+            std::cerr << "ignoring --join " << address << ", expected host:port\n";
+            return;
+        }
+
+        if (!Parse_port("--join", address.substr(colon + 1), join_port))
+            return;
+
+        join_host = address.substr(0, colon);
+    }
+
+    static bool Parse_port(std::string_view option, std::string_view text, int &port)
+    // a TCP port, 1 to 65535, else a warning and port is left as it was
+    {
+        int parsed = 0;
+
+        if (!Parse_number(option, text, parsed))
+            return false;
+
+        if (parsed < 1 || parsed > 65535) {
+            std::cerr << "ignoring " << option << ' ' << text
+                      << ", expected a port from 1 to 65535\n";
+            return false;
+        }
+
+        port = parsed;
+        return true;
+    }
+
+    std::string trace_path;
+    std::string capture_path;
+    std::string script_path;
+    std::string script_report_path;
+    std::string map_path;
+    bool generate = false;
+    std::uint64_t seed = 0;
+    int obstacle_count = 64;
+    float world_scale = 1;
+    int host_port = 0;
+    std::string join_host;
+    int join_port = 0;
+    int spectator_port = 0;
+    std::string telemetry_name;
+    int team_count = 2;
+};
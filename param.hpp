@@ -3,15 +3,15 @@
 #pragma once
 
 namespace param {
-const int window_width = 800;
-const int window_height = 600;
-const float unit_length = 10;
-const float line_width = 1;
-const float reach_radius = window_height / 4;
+constexpr int window_width = 800;
+constexpr int window_height = 600;
+constexpr float unit_length = 10;
+constexpr float line_width = 1;
+constexpr float reach_radius = window_height / 4;
 // const float reach_radius    = window_height;
-const int life = 3;
+constexpr int life = 3;
 // const int life              = 1;
-const int translation_step = 10;
+constexpr int translation_step = 10;
 
 // static float delta() { return 0.1f;
 
@@ -26,14 +26,44 @@ const ALLEGRO_COLOR white = al_map_rgba_f(0.9f, 0.9f, 0.9f, 1);
 const ALLEGRO_COLOR vanish = al_map_rgba_f(0.1f, 0.1f, 0.1f, 0);
 const ALLEGRO_COLOR gray = al_map_rgba_f(0.5f, 0.5f, 0.5f, 0);
 
-const float color_transformation_ratio = 0.5f;
+// by team, in Match::Active_side order; two teams play magenta against cyan
+constexpr int max_teams = 16;
 
-const float sqrt_2 = 1.41421356237309504880f;
-const float sqrt_3 = 1.73205080756887729352f;
-const float pi = 3.14159265358979323846f;
-const float sin_15 = (sqrt_3 - 1) * sqrt_2 / 4;
-const float sin_45 = sqrt_2 / 2;
-const float sin_75 = (sqrt_3 + 1) * sqrt_2 / 4;
+const ALLEGRO_COLOR team_colors[max_teams] = {
+    magenta,
+    cyan,
+    yellow,
+    green,
+    red,
+    blue,
+    white,
+    al_map_rgba_f(0.9f, 0.5f, 0.1f, 1),
+    al_map_rgba_f(0.5f, 0.1f, 0.9f, 1),
+    al_map_rgba_f(0.5f, 0.9f, 0.1f, 1),
+    al_map_rgba_f(0.9f, 0.5f, 0.7f, 1),
+    al_map_rgba_f(0.1f, 0.5f, 0.5f, 1),
+    al_map_rgba_f(0.6f, 0.4f, 0.2f, 1),
+    al_map_rgba_f(0.5f, 0.5f, 0.1f, 1),
+    al_map_rgba_f(0.2f, 0.3f, 0.6f, 1),
+    al_map_rgba_f(0.9f, 0.8f, 0.4f, 1),
+};
+
+const char *const team_names[max_teams] = {"Magenta", "Cyan",  "Yellow", "Green",
+                                           "Red",     "Blue",  "White",  "Orange",
+                                           "Purple",  "Lime",  "Pink",   "Teal",
+                                           "Brown",   "Olive", "Navy",   "Gold"};
+
+// fades, in seconds whatever the tick rate
+constexpr float vanish_seconds = 0.2f;
+constexpr float life_loss_seconds = 0.6f;
+constexpr float highlight_seconds = 0.12f;
+
+constexpr float sqrt_2 = 1.41421356237309504880f;
+constexpr float sqrt_3 = 1.73205080756887729352f;
+constexpr float pi = 3.14159265358979323846f;
+constexpr float sin_15 = (sqrt_3 - 1) * sqrt_2 / 4;
+constexpr float sin_45 = sqrt_2 / 2;
+constexpr float sin_75 = (sqrt_3 + 1) * sqrt_2 / 4;
 
 class Theme
 {
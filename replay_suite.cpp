@@ -0,0 +1,409 @@
+#include "alloc.hpp"
+#include "collision.hpp"
+#include "match.hpp"
+#include "option.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// replay_suite [--update] [--check-speed] [--repeat count] [--speed-tolerance fraction]
+//              [--tests-tolerance fraction] [--memory-tolerance fraction] [replay.txt ...]
+//     play each recorded match (every replays/*.txt here when none is given) through the
+//     simulation as fast as it goes and compare it with the baseline next to it
+//     (replay.baseline): the final state must hash the same, and narrowphase tests per
+//     shot and peak heap must stay within the tolerances. Exits with 1 when any replay
+//     fails. --update writes the baselines instead.
+//     Speed is only comparable on one machine and build type, so it has its own
+//     baseline, replay.speed, which --update writes and git ignores, and only
+//     --check-speed compares sub-steps per second with it.
+//
+// replay_suite --record replay.txt [--turns count] [--seed seed] [game options ...]
+//     record a match of random turns, until one team is left or count turns, with the
+//     game options (--generate, --obstacles, --teams, ...) that set it up.
+//
+// A replay is a text file: "options" and the game options on the first line, then one
+// "turn" per line with the origin and destination as exact hexadecimal floats.
+// Baselines are "key value" lines. This program is built with ALLOC_TRACKING so the
+// heap can be measured, see alloc.hpp.
+
+struct Replay
+{
+    std::vector<std::string> options;
+    std::vector<Turn> turns;
+};
+
+struct Result
+{
+    std::uint64_t turns = 0;
+    std::uint64_t ticks = 0; // sub-steps
+    std::uint64_t tests = 0; // narrowphase, see collision::test_count
+    std::uint64_t peak_bytes = 0;
+    std::uint64_t hash = 0;
+    double seconds = 0; // the fastest of the repeats
+    std::string error;  // a turn the match refused
+
+    double Ticks_per_second() const { return seconds > 0 ? ticks / seconds : 0; }
+    double Tests_per_shot() const { return turns > 0 ? static_cast<double>(tests) / turns : 0; }
+};
+
+struct Tolerance
+{
+    double speed = 0.15;
+    double tests = 0.01;
+    double memory = 0.10;
+};
+
+Option Make_option(const std::vector<std::string> &options)
+{
+    std::vector<char *> arguments{const_cast<char *>("replay_suite")};
+
+    for (const std::string &option : options)
+        arguments.push_back(const_cast<char *>(option.c_str()));
+
+    return Option(static_cast<int>(arguments.size()), arguments.data());
+}
+
+bool Load(const std::string &path, Replay &replay, std::string &error)
+{
+    std::ifstream file{path};
+
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string line;
+
+    while (std::getline(file, line)) {
+        std::istringstream words{line.substr(0, line.find('#'))};
+        std::string command;
+
+        if (!(words >> command))
+            continue;
+
+        if (command == "options") {
+            for (std::string word; words >> word;)
+                replay.options.push_back(word);
+
+            continue;
+        }
+
+        std::string x1, y1, x2, y2;
+
+        if (command != "turn" || !(words >> x1 >> y1 >> x2 >> y2)) {
+            error = path + ": cannot read " + line;
+            return false;
+        }
+
+        auto number = [](const std::string &word) { return std::strtof(word.c_str(), nullptr); };
+        replay.turns.push_back({Vector(number(x1), number(y1)), Vector(number(x2), number(y2))});
+    }
+
+    return true;
+}
+
+Result Play(const Replay &replay, int repeat)
+// the counts of the first run, the time of the fastest
+{
+    Result result;
+
+    for (int run = 0; run < repeat; run++) {
+        const std::uint64_t live_before = alloc::End_frame().live_bytes;
+        const std::uint64_t tests_before = collision::test_count;
+        std::uint64_t ticks = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        Match match = Match(Make_option(replay.options));
+
+        for (std::size_t turn = 0; turn < replay.turns.size(); turn++) {
+            if (!match.Can_fire(replay.turns[turn])) {
+                result.error = "turn " + std::to_string(turn) + " cannot be fired any more";
+                return result;
+            }
+
+            match.Fire(replay.turns[turn]);
+
+            while (match.Shooting()) {
+                match.Step();
+                ticks++;
+            }
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double seconds = elapsed.count();
+
+        if (run == 0) {
+            result.turns = replay.turns.size();
+            result.ticks = ticks;
+            result.tests = collision::test_count - tests_before;
+            result.peak_bytes = alloc::End_frame().peak_live_bytes - live_before;
+            result.hash = match.Hash();
+            result.seconds = seconds;
+        }
+
+        result.seconds = std::min(result.seconds, seconds);
+    }
+
+    return result;
+}
+
+int Record(const std::string &path,
+           int turns,
+           std::uint64_t seed,
+           const std::vector<std::string> &options)
+{
+    std::ofstream file{path};
+
+    if (!file) {
+        std::cerr << "cannot write " << path << '\n';
+        return 1;
+    }
+
+    Match match = Match(Make_option(options));
+    Random random = Random(seed);
+
+    file << "options";
+
+    for (const std::string &option : options)
+        file << ' ' << option;
+
+    file << '\n';
+
+    int turn = 0;
+
+    for (; turn < turns && !match.Over(); turn++) {
+        Turn next = Random_turn(match, random);
+        char line[128];
+
+        std::snprintf(line, sizeof(line), "turn %a %a %a %a\n", next.origin.X(), next.origin.Y(),
+                      next.destination.X(), next.destination.Y());
+        file << line;
+
+        match.Fire(next);
+
+        while (match.Shooting())
+            match.Step();
+    }
+
+    std::cout << "recorded " << turn << " turns to " << path << ", " << match.Pawns().size()
+              << " pawns on the board at the end\n";
+
+    return 0;
+}
+
+bool Write_baseline(const std::string &path, const std::string &speed_path, const Result &result)
+// what any machine must reproduce in path, this machine's speed in speed_path
+{
+    std::ofstream file{path};
+
+    file << std::fixed << std::setprecision(3) << "turns " << result.turns << '\n'
+         << "ticks " << result.ticks << '\n'
+         << "tests_per_shot " << result.Tests_per_shot() << '\n'
+         << "peak_bytes " << result.peak_bytes << '\n'
+         << "hash " << std::hex << result.hash << std::dec << '\n';
+
+    std::ofstream speed_file{speed_path};
+
+    speed_file << std::fixed << std::setprecision(3) << "ticks_per_s " << result.Ticks_per_second()
+               << '\n';
+
+    return file && speed_file;
+}
+
+bool Check(const std::string &path, const Result &result, const Tolerance &tolerance)
+// prints what differs from the baseline and returns whether it passes
+{
+    std::ifstream file{path};
+
+    if (!file) {
+        std::cout << "    no baseline " << path << ", record one with --update\n";
+        return false;
+    }
+
+    double ticks = 0;
+    double tests_per_shot = 0;
+    double peak_bytes = 0;
+    std::uint64_t hash = 0;
+    std::string key;
+
+    while (file >> key) {
+        if (key == "hash")
+            file >> std::hex >> hash >> std::dec;
+        else if (key == "ticks")
+            file >> ticks;
+        else if (key == "tests_per_shot")
+            file >> tests_per_shot;
+        else if (key == "peak_bytes")
+            file >> peak_bytes;
+        else
+            file.ignore(256, '\n');
+    }
+
+    bool pass = true;
+
+    auto fail = [&](const std::string &why) {
+        std::cout << "    " << why << '\n';
+        pass = false;
+    };
+
+    if (result.hash != hash || result.ticks != ticks)
+        fail("the match played differently: the final state or the sub-step count changed");
+
+    if (result.Tests_per_shot() > tests_per_shot * (1 + tolerance.tests))
+        fail("more narrowphase tests per shot than the baseline's " + std::to_string(tests_per_shot));
+
+    if (result.peak_bytes > peak_bytes * (1 + tolerance.memory))
+        fail("more heap than the baseline's " + std::to_string(static_cast<std::uint64_t>(peak_bytes))
+             + " bytes");
+
+    return pass;
+}
+
+bool Check_speed(const std::string &path, const Result &result, const Tolerance &tolerance)
+// against the speed recorded by --update on this machine
+{
+    std::ifstream file{path};
+    std::string key;
+    double ticks_per_s = 0;
+
+    if (!(file >> key >> ticks_per_s) || key != "ticks_per_s") {
+        std::cout << "    no speed baseline " << path << ", record one here with --update\n";
+        return false;
+    }
+
+    if (result.Ticks_per_second() >= ticks_per_s * (1 - tolerance.speed))
+        return true;
+
+    std::cout << "    slower than the baseline's " << std::to_string(ticks_per_s)
+              << " sub-steps per second\n";
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    std::string record_path;
+    int record_turns = 3000;
+    std::uint64_t seed = 1;
+    std::vector<std::string> others;
+    bool update = false;
+    bool check_speed = false;
+    int repeat = 3;
+    Tolerance tolerance;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (argument == "--record" && has_value)
+            record_path = argv[++i];
+
+        else if (argument == "--turns" && has_value)
+            Option::Parse_number(argument, argv[++i], record_turns);
+
+        else if (argument == "--seed" && has_value)
+            Option::Parse_number(argument, argv[++i], seed);
+
+        else if (argument == "--update")
+            update = true;
+
+        else if (argument == "--check-speed")
+            check_speed = true;
+
+        else if (argument == "--repeat" && has_value)
+            Option::Parse_number(argument, argv[++i], repeat);
+
+        else if (argument == "--speed-tolerance" && has_value)
+            Option::Parse_number(argument, argv[++i], tolerance.speed);
+
+        else if (argument == "--tests-tolerance" && has_value)
+            Option::Parse_number(argument, argv[++i], tolerance.tests);
+
+        else if (argument == "--memory-tolerance" && has_value)
+            Option::Parse_number(argument, argv[++i], tolerance.memory);
+
+        else
+            others.push_back(argument);
+    }
+
+    repeat = std::max(1, repeat);
+
+    // game options when recording, replays otherwise
+    if (!record_path.empty())
+        return Record(record_path, record_turns, seed, others);
+
+    std::vector<std::string> paths = others;
+
+    if (paths.empty() && std::filesystem::is_directory("replays")) {
+        for (const auto &entry : std::filesystem::directory_iterator("replays"))
+            if (entry.path().extension() == ".txt")
+                paths.push_back(entry.path().string());
+
+        std::sort(paths.begin(), paths.end());
+    }
+
+    if (paths.empty()) {
+        std::cerr << "no replays given and no replays directory here\n";
+        return 1;
+    }
+
+    int failed = 0;
+
+    std::cout << std::left << std::setw(28) << "replay" << std::right << std::setw(8) << "turns"
+              << std::setw(12) << "sub-steps" << std::setw(14) << "sub-steps/s" << std::setw(14)
+              << "tests/shot" << std::setw(12) << "peak KiB" << std::setw(18) << "hash" << '\n';
+
+    for (const std::string &path : paths) {
+        Replay replay;
+        std::string error;
+
+        if (!Load(path, replay, error)) {
+            std::cout << error << '\n';
+            failed++;
+            continue;
+        }
+
+        Result result = Play(replay, repeat);
+        std::filesystem::path name = std::filesystem::path(path).filename();
+        std::string baseline_path = std::filesystem::path(path).replace_extension(".baseline").string();
+        std::string speed_path = std::filesystem::path(path).replace_extension(".speed").string();
+
+        std::cout << std::left << std::setw(28) << name.string() << std::right << std::setw(8)
+                  << replay.turns.size() << std::setw(12) << result.ticks << std::setw(14) << std::fixed
+                  << std::setprecision(0) << result.Ticks_per_second() << std::setw(14)
+                  << std::setprecision(1) << result.Tests_per_shot() << std::setw(12)
+                  << result.peak_bytes / 1024 << std::setw(18) << std::hex << result.hash << std::dec
+                  << '\n';
+
+        if (!result.error.empty()) {
+            std::cout << "    " << result.error << '\n';
+            failed++;
+        } else if (update) {
+            if (!Write_baseline(baseline_path, speed_path, result)) {
+                std::cout << "    cannot write " << baseline_path << " or " << speed_path << '\n';
+                failed++;
+            }
+        } else {
+            // both, so a failing replay reports everything that differs
+            bool pass = Check(baseline_path, result, tolerance);
+
+            if (check_speed)
+                pass = Check_speed(speed_path, result, tolerance) && pass;
+
+            failed += !pass;
+        }
+    }
+
+    if (!update)
+        std::cout << (failed ? std::to_string(failed) + " of " : "all ") << paths.size()
+                  << " replays " << (failed ? "failed" : "passed") << '\n';
+
+    return failed ? 1 : 0;
+}
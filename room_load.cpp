@@ -0,0 +1,297 @@
+#include "map_generator.hpp"
+#include "match.hpp"
+#include "option.hpp"
+#include "room_server.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <fstream>
+#include <unistd.h>
+#endif
+
+// room_load [--rooms count] [--workers count] [--turns count] [--rate turns_per_second]
+//           [--seconds count] [--turn-seconds seconds] [--malformed one_in]
+//           [--seed seed] [game options ...]
+//     host count rooms on a pool of workers (one per core by default) and play random
+//     turns in all of them.
+//     Without --rate every room submits its next turn as soon as the last one settles,
+//     until each played --turns: this saturates the workers and gives the throughput.
+//     With --rate turns arrive at that total pace for --seconds, round robin over the
+//     rooms whose last turn settled, which gives the latency a player would see.
+//     Rooms per core assume one turn per room every --turn-seconds (aiming included).
+//     --malformed replaces about one turn in one_in by a NaN, infinite or far out of
+//     reach destination, as a broken client could send; the server must reject exactly
+//     those turns.
+//     Game options (--generate, --map, --world-scale, ...) pick the map of every room.
+
+struct Worker_report
+{
+    std::vector<double> process_us;
+    std::vector<double> total_us;
+    long sub_steps = 0;
+    long games = 0;
+    long rejected = 0;
+    long malformed = 0;
+    long misjudged = 0; // malformed turns accepted, or legal ones rejected
+};
+
+struct Pending
+{
+    Turn turn;
+    bool malformed = false;
+    std::atomic<bool> ready{false};
+    std::uint32_t played = 0; // only touched by the room's worker
+};
+
+double Percentile(std::vector<double> &samples, double fraction)
+{
+    if (samples.empty())
+        return 0;
+
+    std::size_t rank = std::min(samples.size() - 1,
+                                static_cast<std::size_t>(fraction * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+
+    return samples[rank];
+}
+
+double Resident_megabytes()
+// 0 where it cannot be read
+{
+#ifdef __linux__
+    std::ifstream statm{"/proc/self/statm"};
+    long size = 0;
+    long resident = 0;
+
+    if (statm >> size >> resident)
+        return static_cast<double>(resident) * sysconf(_SC_PAGESIZE) / (1024 * 1024);
+#endif
+
+    return 0;
+}
+
+Turn Next_turn(const Match &match, Random &random, int malformed_one_in, bool &malformed)
+// a random legal turn, or now and then one no client of the game would send
+{
+    Turn turn = Random_turn(match, random);
+    malformed = malformed_one_in > 0 && random.Uniform(1, malformed_one_in) == 1;
+
+    if (!malformed)
+        return turn;
+
+    switch (random.Uniform(0, 2)) {
+    case 0:
+        turn.destination = Vector(NAN, NAN);
+        break;
+
+    case 1:
+        turn.destination = Vector(INFINITY, turn.origin.Y());
+        break;
+
+    default:
+        turn.destination = turn.origin + Vector(1e7f, 0);
+        break;
+    }
+
+    return turn;
+}
+
+void Print_latency(const char *name, std::vector<double> &samples)
+{
+    std::cout << name << "p50 " << Percentile(samples, 0.5) << ", p99 "
+              << Percentile(samples, 0.99) << ", p99.9 " << Percentile(samples, 0.999)
+              << ", max " << Percentile(samples, 1) << " us\n";
+}
+
+int main(int argc, char **argv)
+{
+    std::uint32_t room_count = 4000;
+    int worker_count = std::max(1u, std::thread::hardware_concurrency());
+    std::uint32_t turns = 50;
+    double rate = 0;
+    double seconds = 5;
+    double turn_seconds = 5;
+    int malformed_one_in = 0;
+    std::uint64_t seed = 1;
+    std::vector<char *> game_arguments{argv[0]};
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (argument == "--rooms" && has_value)
+            room_count = std::stoul(argv[++i]);
+
+        else if (argument == "--workers" && has_value)
+            worker_count = std::max(1, std::stoi(argv[++i]));
+
+        else if (argument == "--turns" && has_value)
+            turns = std::stoul(argv[++i]);
+
+        else if (argument == "--rate" && has_value)
+            rate = std::stod(argv[++i]);
+
+        else if (argument == "--seconds" && has_value)
+            seconds = std::stod(argv[++i]);
+
+        else if (argument == "--turn-seconds" && has_value)
+            turn_seconds = std::stod(argv[++i]);
+
+        else if (argument == "--malformed" && has_value)
+            malformed_one_in = std::max(0, std::stoi(argv[++i]));
+
+        else if (argument == "--seed" && has_value)
+            seed = std::stoull(argv[++i]);
+
+        else
+            game_arguments.push_back(argv[i]);
+    }
+
+    Option option = Option(static_cast<int>(game_arguments.size()), game_arguments.data());
+    const bool paced = rate > 0;
+
+    std::vector<Worker_report> reports(worker_count);
+    std::vector<Pending> pending(room_count);
+    std::vector<Random> randoms;
+    randoms.reserve(room_count);
+
+    for (std::uint32_t room = 0; room < room_count; room++)
+        randoms.push_back(Random(seed + room));
+
+    room::Server *server_pointer = nullptr;
+
+    // a room's Random and Pending::played are only used by its worker, like its match
+    auto on_result = [&](const room::Result &result, const Match &match) {
+        Worker_report &report = reports[result.worker];
+        Pending &next = pending[result.room];
+
+        report.process_us.push_back(result.process_us);
+        report.total_us.push_back(result.queue_us + result.process_us);
+        report.sub_steps += result.sub_steps;
+        report.games += result.game_over;
+        report.rejected += !result.accepted;
+        report.malformed += next.malformed;
+        report.misjudged += next.malformed == result.accepted;
+
+        Turn turn = Next_turn(match, randoms[result.room], malformed_one_in, next.malformed);
+
+        if (paced) {
+            next.turn = turn;
+            next.ready.store(true, std::memory_order_release);
+        } else if (++next.played < turns) {
+            server_pointer->Submit(result.room, turn);
+        }
+    };
+
+    double memory_before = Resident_megabytes();
+    auto start = std::chrono::steady_clock::now();
+
+    room::Server server{option, room_count, worker_count, on_result};
+    server_pointer = &server;
+    server.Wait_until_ready();
+
+    std::chrono::duration<double, std::milli> build_time = std::chrono::steady_clock::now() - start;
+    double memory_per_room = (Resident_megabytes() - memory_before) * 1024 / room_count;
+
+    // every room starts from the same state, one look at a fresh match gives the first turns
+    Match fresh = Match(option);
+
+    for (std::uint32_t room = 0; room < room_count; room++) {
+        Pending &first = pending[room];
+        first.turn = Next_turn(fresh, randoms[room], malformed_one_in, first.malformed);
+        first.ready.store(true, std::memory_order_release);
+    }
+
+    start = std::chrono::steady_clock::now();
+    long submitted = 0;
+    long skipped = 0; // paced turns whose room was still busy
+
+    if (paced) {
+        std::uint32_t cursor = 0;
+
+        while (true) {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            if (elapsed.count() >= seconds)
+                break;
+
+            for (long due = static_cast<long>(elapsed.count() * rate); submitted + skipped < due;) {
+                Pending &next = pending[cursor];
+                std::uint32_t room = cursor;
+                cursor = (cursor + 1) % room_count;
+
+                if (next.ready.load(std::memory_order_acquire)) {
+                    next.ready.store(false, std::memory_order_relaxed);
+                    server.Submit(room, next.turn);
+                    submitted++;
+                } else {
+                    skipped++;
+                }
+            }
+
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    } else if (turns > 0) {
+        for (std::uint32_t room = 0; room < room_count; room++)
+            server.Submit(room, pending[room].turn);
+    }
+
+    server.Stop();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    Worker_report total;
+
+    for (Worker_report &report : reports) {
+        total.process_us.insert(total.process_us.end(), report.process_us.begin(), report.process_us.end());
+        total.total_us.insert(total.total_us.end(), report.total_us.begin(), report.total_us.end());
+        total.sub_steps += report.sub_steps;
+        total.games += report.games;
+        total.rejected += report.rejected;
+        total.malformed += report.malformed;
+        total.misjudged += report.misjudged;
+    }
+
+    double processed = static_cast<double>(total.process_us.size());
+    double busy_seconds = 0;
+
+    for (double us : total.process_us)
+        busy_seconds += us / 1e6;
+
+    // per core: turns one worker can process per second of busy time
+    double turns_per_core = busy_seconds > 0 ? processed / busy_seconds : 0;
+
+    std::cout << std::fixed << std::setprecision(1) << "rooms            " << room_count << " on "
+              << worker_count << " workers, built in " << build_time.count() << " ms";
+
+    if (memory_per_room > 0)
+        std::cout << ", " << memory_per_room << " KiB resident each";
+
+    std::cout << "\nturns            " << total.process_us.size() << " in " << elapsed.count() << " s ("
+              << total.games << " finished games, " << total.rejected << " rejected of "
+              << total.malformed << " malformed, "
+              << total.sub_steps / std::max(processed, 1.0) << " sub-steps each)\n";
+
+    if (paced)
+        std::cout << "offered          " << rate << " turns/s, " << skipped
+                  << " skipped because the room was still busy\n";
+
+    std::cout << "throughput       " << processed / elapsed.count() << " turns/s, "
+              << turns_per_core << " turns/s per busy core\n"
+              << "capacity         " << turns_per_core * turn_seconds
+              << " rooms per core at one turn every " << turn_seconds << " s\n";
+
+    Print_latency("processing       ", total.process_us);
+    Print_latency(paced ? "submit to done   " : "submit to done   (saturated, includes queueing) ",
+                  total.total_us);
+
+    return total.misjudged == 0 ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+#include "match.hpp"
+#include "option.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#pragma once
+
+// Many independent matches (rooms) in one process.
+//
+// A room only advances when one of its players submits a turn: the worker fires it
+// and runs the shot until it settles, there is no timer. Room r belongs to worker
+// r % worker_count for its whole life and is built on that worker's thread, so a
+// Match is only ever touched by one thread and needs no lock. Each worker has its own
+// inbox, whose mutex is held just long enough to push one input or to swap the whole
+// inbox out; no lock is shared between workers.
+
+namespace room {
+using Clock = std::chrono::steady_clock;
+
+struct Input
+{
+    std::uint32_t room;
+    Turn turn;
+    Clock::time_point submitted;
+};
+
+struct Result
+{
+    std::uint32_t room;
+    int worker;
+    bool accepted;  // false when Match::Can_fire refused the turn, nothing was fired
+    bool game_over; // the turn ended a game, the room already started the next one
+    int active_side;
+    std::uint32_t sub_steps;
+    double queue_us;   // submitted until the worker picked it up
+    double process_us; // firing and simulating the shot
+};
+
+class Server
+{
+public:
+    // runs on the room's worker thread, the only one allowed to look at its match
+    using Callback = std::function<void(const Result &, const Match &)>;
+
+    Server(const Option &option, std::uint32_t room_count, int worker_count, Callback on_result);
+    ~Server() { Stop(); }
+
+    Server(const Server &) = delete;
+    Server &operator=(const Server &) = delete;
+
+    bool Submit(std::uint32_t room, const Turn &turn);
+    void Wait_until_ready();
+    void Stop();
+
+    int Worker_count() const { return static_cast<int>(workers.size()); }
+    std::uint32_t Room_count() const { return room_count; }
+
+private:
+    class Worker
+    {
+    public:
+        Worker(const Server &server, int index, std::uint32_t room_count);
+
+        void Push(const Input &input);
+        void Wait_until_ready();
+        void Stop();
+
+    private:
+        void Run(std::uint32_t room_count);
+        void Process(const Input &input);
+
+        const Server &server;
+        int index;
+        std::vector<std::unique_ptr<Match>> rooms; // room r is rooms[r / worker_count]
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<Input> inbox;
+        bool ready = false;
+        bool stopping = false;
+
+        std::thread thread;
+    };
+
+    const Option &option;
+    std::uint32_t room_count;
+    Callback on_result;
+    std::vector<std::unique_ptr<Worker>> workers;
+};
+}; // namespace room
+
+room::Server::Server(const Option &option,
+                     std::uint32_t room_count,
+                     int worker_count,
+                     Callback on_result)
+    : option{option}
+    , room_count{room_count}
+    , on_result{std::move(on_result)}
+{
+    workers.reserve(worker_count);
+
+    for (int i = 0; i < worker_count; i++) {
+        std::uint32_t rooms_of_worker = room_count / worker_count
+                                        + (static_cast<std::uint32_t>(i) < room_count % worker_count);
+        workers.push_back(std::make_unique<Worker>(*this, i, rooms_of_worker));
+    }
+}
+
+bool room::Server::Submit(std::uint32_t room, const Turn &turn)
+// thread safe, the result comes back through the callback on the room's worker thread;
+// false, and no callback, for a room that does not exist
+{
+    if (room >= room_count)
+        return false;
+
+    workers[room % workers.size()]->Push({room, turn, Clock::now()});
+    return true;
+}
+
+void room::Server::Wait_until_ready()
+// every room built
+{
+    for (auto &worker : workers)
+        worker->Wait_until_ready();
+}
+
+void room::Server::Stop()
+// finishes the inputs already submitted
+{
+    for (auto &worker : workers)
+        worker->Stop();
+}
+
+room::Server::Worker::Worker(const Server &server, int index, std::uint32_t room_count)
+    : server{server}
+    , index{index}
+    , thread{[this, room_count] { Run(room_count); }}
+{}
+
+void room::Server::Worker::Push(const Input &input)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        inbox.push_back(input);
+    }
+
+    wake.notify_one();
+}
+
+void room::Server::Worker::Wait_until_ready()
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    wake.wait(lock, [&] { return ready; });
+}
+
+void room::Server::Worker::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (stopping)
+            return;
+
+        stopping = true;
+    }
+
+    wake.notify_all();
+    thread.join();
+}
+
+void room::Server::Worker::Run(std::uint32_t room_count)
+{
+    rooms.reserve(room_count);
+
+    for (std::uint32_t i = 0; i < room_count; i++)
+        rooms.push_back(std::make_unique<Match>(server.option));
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        ready = true;
+    }
+
+    wake.notify_all();
+
+    std::vector<Input> batch;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            wake.wait(lock, [&] { return stopping || !inbox.empty(); });
+
+            if (inbox.empty())
+                return;
+
+            std::swap(batch, inbox);
+        }
+
+        for (const Input &input : batch)
+            Process(input);
+
+        batch.clear();
+    }
+}
+
+void room::Server::Worker::Process(const Input &input)
+// the turn comes from a client, so it is fired only once Can_fire has checked it: a
+// position the player holds and a finite destination on the reach circle, which keeps a
+// NaN or an endless shot from crashing or stalling every room of this worker
+{
+    Clock::time_point start = Clock::now();
+    Match &match = *rooms[input.room / server.workers.size()];
+
+    Result result{};
+    result.room = input.room;
+    result.worker = index;
+    result.accepted = match.Can_fire(input.turn);
+
+    if (result.accepted) {
+        match.Fire(input.turn);
+
+        while (match.Shooting()) {
+            match.Step();
+            result.sub_steps++;
+        }
+    }
+
+    result.game_over = match.Over();
+
+    if (result.game_over)
+        match.Reset();
+
+    result.active_side = match.Active_side();
+    result.queue_us = std::chrono::duration<double, std::micro>(start - input.submitted).count();
+    result.process_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+    server.on_result(result, match);
+}
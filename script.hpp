@@ -0,0 +1,280 @@
+#include <allegro5/allegro5.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#pragma once
+
+// Scripted sessions of the real game loop, for performance runs without a player.
+//
+// A script is a text file of lines "frame command arguments", # starts a comment:
+//     move x y              the mouse moves to x, y (screen coordinates)
+//     wheel x y dz          the wheel turns by dz at x, y
+//     down x y button       a mouse button is pressed at x, y (1 left, 2 right)
+//     up x y button         and released
+//     key name|keycode      a key is typed: up, down, left, right, enter, escape, w, a, s,
+//                           d, pgup, pgdn, equals, minus, or an Allegro keycode
+//     quit                  the session ends, as it also does after the last line
+// Frames count timer ticks. The driver replaces the timer: each time the game has
+// drained its queue, it emits the events of the next frame and then that frame's tick
+// through one user event source, so the loop runs as fast as it can and every run of a
+// script goes through the same states. scripts/ has an example.
+
+namespace script {
+struct Step
+{
+    std::uint32_t frame;
+    ALLEGRO_EVENT event;
+};
+
+bool Parse(std::istream &input, std::vector<Step> &steps, std::string &error);
+
+class Driver
+{
+public:
+    Driver();
+    ~Driver() { al_destroy_user_event_source(&source); }
+
+    Driver(const Driver &) = delete;
+    Driver &operator=(const Driver &) = delete;
+
+    bool Load(const std::string &path, std::string &error);
+    void Register(ALLEGRO_EVENT_QUEUE *queue) { al_register_event_source(queue, &source); }
+
+    void Emit_frame();
+    void Count_event(double microseconds);
+    void Count_frame();
+    void Write_report(std::ostream &output, std::uint32_t turns, std::uint64_t hash) const;
+
+    bool Finished() const { return finished; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    ALLEGRO_EVENT_SOURCE source;
+    std::vector<Step> steps;
+    std::size_t next_step;
+    std::uint32_t frame;
+    bool finished;
+
+    Clock::time_point start;
+    Clock::time_point last_frame;
+    std::vector<double> frame_ms;
+    std::uint64_t events;
+    double dispatch_us; // handling events, drawing excluded
+};
+}; // namespace script
+
+bool script::Parse(std::istream &input, std::vector<Step> &steps, std::string &error)
+{
+    static const std::pair<const char *, int> key_names[]
+        = {{"up", ALLEGRO_KEY_UP},       {"down", ALLEGRO_KEY_DOWN},   {"left", ALLEGRO_KEY_LEFT},
+           {"right", ALLEGRO_KEY_RIGHT}, {"enter", ALLEGRO_KEY_ENTER}, {"escape", ALLEGRO_KEY_ESCAPE},
+           {"w", ALLEGRO_KEY_W},         {"a", ALLEGRO_KEY_A},         {"s", ALLEGRO_KEY_S},
+           {"d", ALLEGRO_KEY_D},         {"pgup", ALLEGRO_KEY_PGUP},   {"pgdn", ALLEGRO_KEY_PGDN},
+           {"equals", ALLEGRO_KEY_EQUALS}, {"minus", ALLEGRO_KEY_MINUS}};
+
+    std::string line;
+    int line_number = 0;
+    int mouse_x = 0;
+    int mouse_y = 0;
+
+    while (std::getline(input, line)) {
+        line_number++;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream words{line};
+        Step step{};
+        std::string command;
+
+        if (!(words >> step.frame))
+            continue;
+
+        auto fail = [&](const std::string &why) {
+            error = "line " + std::to_string(line_number) + ": " + why;
+            return false;
+        };
+
+        if (!steps.empty() && step.frame < steps.back().frame)
+            return fail("frames must not go back");
+
+        if (!(words >> command))
+            return fail("expected a command");
+
+        ALLEGRO_EVENT &event = step.event;
+
+        if (command == "move" || command == "wheel" || command == "down" || command == "up") {
+            int x;
+            int y;
+            int extra = 0;
+
+            if (!(words >> x >> y) || (command != "move" && !(words >> extra)))
+                return fail("expected " + command + (command == "move" ? " x y" : " x y value"));
+
+            event.mouse.x = x;
+            event.mouse.y = y;
+            event.mouse.dx = x - mouse_x;
+            event.mouse.dy = y - mouse_y;
+            mouse_x = x;
+            mouse_y = y;
+
+            if (command == "move" || command == "wheel") {
+                event.type = ALLEGRO_EVENT_MOUSE_AXES;
+                event.mouse.dz = extra;
+            } else {
+                event.type = command == "down" ? ALLEGRO_EVENT_MOUSE_BUTTON_DOWN
+                                               : ALLEGRO_EVENT_MOUSE_BUTTON_UP;
+                event.mouse.button = extra;
+                event.mouse.dx = event.mouse.dy = 0;
+            }
+        } else if (command == "key") {
+            std::string name;
+
+            if (!(words >> name))
+                return fail("expected a key");
+
+            event.type = ALLEGRO_EVENT_KEY_CHAR;
+            auto found = std::find_if(std::begin(key_names), std::end(key_names), [&](const auto &key) {
+                return name == key.first;
+            });
+
+            // a keycode is plain digits that fit an int
+            int keycode = 0;
+            const char *end = name.data() + name.size();
+            auto parsed = std::from_chars(name.data(), end, keycode);
+            bool digits = std::all_of(name.begin(), name.end(), [](unsigned char c) {
+                return std::isdigit(c) != 0;
+            });
+
+            if (found != std::end(key_names))
+                event.keyboard.keycode = found->second;
+            else if (digits && parsed.ec == std::errc{} && parsed.ptr == end)
+                event.keyboard.keycode = keycode;
+            else
+                return fail("unknown key " + name);
+        } else if (command == "quit") {
+            event.type = ALLEGRO_EVENT_DISPLAY_CLOSE;
+        } else {
+            return fail("unknown command " + command);
+        }
+
+        steps.push_back(step);
+    }
+
+    return true;
+}
+
+script::Driver::Driver()
+    : next_step{0}
+    , frame{0}
+    , finished{false}
+    , events{0}
+    , dispatch_us{0}
+{
+    al_init_user_event_source(&source);
+}
+
+bool script::Driver::Load(const std::string &path, std::string &error)
+{
+    std::ifstream file{path};
+
+    if (!file) {
+        error = "cannot open script " + path;
+        return false;
+    }
+
+    if (!Parse(file, steps, error)) {
+        error = path + " " + error;
+        return false;
+    }
+
+    // an implicit quit one frame after the last line
+    Step quit{};
+    quit.frame = steps.empty() ? 0 : steps.back().frame + 1;
+    quit.event.type = ALLEGRO_EVENT_DISPLAY_CLOSE;
+    steps.push_back(quit);
+
+    return true;
+}
+
+void script::Driver::Emit_frame()
+// the scripted events of this frame, then its tick; call when the queue is empty
+{
+    if (finished)
+        return;
+
+    if (frame == 0)
+        start = last_frame = Clock::now();
+
+    for (; next_step < steps.size() && steps[next_step].frame == frame; next_step++) {
+        ALLEGRO_EVENT event = steps[next_step].event;
+        al_emit_user_event(&source, &event, nullptr);
+
+        if (event.type == ALLEGRO_EVENT_DISPLAY_CLOSE) {
+            finished = true;
+            return;
+        }
+    }
+
+    ALLEGRO_EVENT tick{};
+    tick.type = ALLEGRO_EVENT_TIMER;
+    tick.timer.count = frame;
+    al_emit_user_event(&source, &tick, nullptr);
+
+    frame++;
+}
+
+void script::Driver::Count_event(double microseconds)
+{
+    events++;
+    dispatch_us += microseconds;
+}
+
+void script::Driver::Count_frame()
+// after each flip
+{
+    Clock::time_point now = Clock::now();
+    frame_ms.push_back(std::chrono::duration<double, std::milli>(now - last_frame).count());
+    last_frame = now;
+}
+
+void script::Driver::Write_report(std::ostream &output, std::uint32_t turns, std::uint64_t hash) const
+// one "key value" per line, so runs of different builds diff and parse easily
+{
+    double session_s = std::chrono::duration<double>(Clock::now() - start).count();
+    std::vector<double> sorted = frame_ms;
+    std::sort(sorted.begin(), sorted.end());
+
+    auto percentile = [&](double fraction) {
+        if (sorted.empty())
+            return 0.0;
+
+        return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(fraction * sorted.size()))];
+    };
+
+    double mean = 0;
+
+    for (double ms : sorted)
+        mean += ms / sorted.size();
+
+    output << std::fixed << std::setprecision(3) << "session_s " << session_s << '\n'
+           << "ticks " << frame << '\n'
+           << "frames " << sorted.size() << '\n'
+           << "frame_ms_mean " << mean << '\n'
+           << "frame_ms_p50 " << percentile(0.5) << '\n'
+           << "frame_ms_p95 " << percentile(0.95) << '\n'
+           << "frame_ms_p99 " << percentile(0.99) << '\n'
+           << "frame_ms_max " << percentile(1) << '\n'
+           << "events " << events << '\n'
+           << "events_per_s " << (dispatch_us > 0 ? events / dispatch_us * 1e6 : 0) << '\n'
+           << "dispatch_us_mean " << (events > 0 ? dispatch_us / events : 0) << '\n'
+           << "turns " << turns << '\n'
+           << "match_hash " << std::hex << hash << std::dec << '\n';
+}
@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+#pragma once
+
+// Sequences of the game, like a turn, written as C++20 coroutines.
+//
+// A Task is a coroutine that co_awaits what it needs next: Scheduler::Next_tick, a
+// Signal that an input handler emits, or another Task, which runs until it finishes and
+// hands back its result. The Scheduler owns the tasks started on it and resumes each
+// only when what it awaits has happened, so a sequence waiting for the player costs
+// nothing per tick, and a new sequence is a new coroutine rather than a new State and
+// the checks for it spread over the event handlers.
+
+namespace sequence {
+template <typename T>
+class Task;
+
+namespace detail {
+struct Final_awaiter
+// a finished task resumes whatever awaited it, if anything
+{
+    bool await_ready() const noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) const noexcept
+    {
+        std::coroutine_handle<> continuation = finished.promise().continuation;
+
+        return continuation ? continuation : std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+struct Promise_base
+{
+    std::coroutine_handle<> continuation;
+
+    // a task starts when it is awaited or handed to a Scheduler
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    Final_awaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() const { std::terminate(); }
+};
+
+template <typename T>
+struct Promise : Promise_base
+{
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    void return_value(T result) { value = std::move(result); }
+    T Result() { return std::move(*value); }
+};
+
+template <>
+struct Promise<void> : Promise_base
+{
+    Task<void> get_return_object();
+    void return_void() const {}
+    void Result() const {}
+};
+}; // namespace detail
+
+template <typename T = void>
+class Task
+{
+public:
+    using promise_type = detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit Task(Handle handle)
+        : handle{handle}
+    {}
+
+    Task(Task &&other) noexcept
+        : handle{std::exchange(other.handle, {})}
+    {}
+
+    Task &operator=(Task &&other) noexcept
+    {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+
+    ~Task()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    // co_await task: run it, and carry on with its result once it has finished
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume() { return handle.promise().Result(); }
+
+    Handle Release() { return std::exchange(handle, {}); }
+
+private:
+    Handle handle;
+};
+
+template <typename T>
+Task<T> detail::Promise<T>::get_return_object()
+{
+    return Task<T>{Task<T>::Handle::from_promise(*this)};
+}
+
+inline Task<void> detail::Promise<void>::get_return_object()
+{
+    return Task<void>{Task<void>::Handle::from_promise(*this)};
+}
+
+class Scheduler
+{
+public:
+    Scheduler() = default;
+    ~Scheduler();
+
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    void Start(Task<> task);
+    void Tick();
+    void Run_ready();
+
+    auto Next_tick()
+    // co_await scheduler.Next_tick(): carry on at the next Tick
+    {
+        struct Awaiter
+        {
+            Scheduler &scheduler;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> waiting) { scheduler.tick_waiters.push_back(waiting); }
+            void await_resume() const noexcept {}
+        };
+
+        return Awaiter{*this};
+    }
+
+    void Resume_later(std::coroutine_handle<> waiting) { ready.push_back(waiting); }
+
+    std::size_t Waiting_for_tick() const { return tick_waiters.size(); }
+
+private:
+    void Collect();
+
+    std::vector<Task<>::Handle> tasks;                 // started here, finished or not
+    std::vector<std::coroutine_handle<>> tick_waiters; // resumed by the next Tick
+    std::vector<std::coroutine_handle<>> ready;        // resumed by the next Run_ready
+    std::vector<std::coroutine_handle<>> resuming;     // the waiters being resumed
+};
+
+template <typename T>
+class Signal
+// a value that one coroutine at a time awaits, emitted by the code that sees it
+// happen; emitting while nothing awaits does nothing
+{
+public:
+    Signal(Scheduler &scheduler)
+        : scheduler{scheduler}
+    {}
+
+    bool Awaited() const { return static_cast<bool>(waiting); }
+
+    void Emit(T emitted)
+    // the waiting coroutine resumes at the scheduler's next Run_ready, not in here
+    {
+        if (!waiting)
+            return;
+
+        value = std::move(emitted);
+        scheduler.Resume_later(std::exchange(waiting, {}));
+    }
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> awaiting) { waiting = awaiting; }
+    T await_resume() { return std::move(*std::exchange(value, std::nullopt)); }
+
+private:
+    Scheduler &scheduler;
+    std::coroutine_handle<> waiting;
+    std::optional<T> value;
+};
+}; // namespace sequence
+
+sequence::Scheduler::~Scheduler()
+// a task still suspended is destroyed with the tasks it awaits
+{
+    for (Task<>::Handle task : tasks)
+        task.destroy();
+}
+
+void sequence::Scheduler::Start(Task<> task)
+// runs the task up to its first co_await
+{
+    Task<>::Handle handle = task.Release();
+
+    tasks.push_back(handle);
+    handle.resume();
+    Collect();
+}
+
+void sequence::Scheduler::Tick()
+// resumes what awaited this tick; what awaits again waits for the next one
+{
+    resuming.swap(tick_waiters);
+
+    for (std::coroutine_handle<> waiting : resuming)
+        waiting.resume();
+
+    resuming.clear();
+    Run_ready();
+}
+
+void sequence::Scheduler::Run_ready()
+// resumes the coroutines whose signals were emitted, and those these emit in turn
+{
+    while (!ready.empty()) {
+        resuming.swap(ready);
+
+        for (std::coroutine_handle<> waiting : resuming)
+            waiting.resume();
+
+        resuming.clear();
+    }
+
+    Collect();
+}
+
+void sequence::Scheduler::Collect()
+{
+    tasks.erase(std::remove_if(tasks.begin(),
+                               tasks.end(),
+                               [](Task<>::Handle task) {
+                                   if (!task.done())
+                                       return false;
+
+                                   task.destroy();
+                                   return true;
+                               }),
+                tasks.end());
+}
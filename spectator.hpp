@@ -0,0 +1,526 @@
+#include "match.hpp"
+#include "net.hpp"
+#include "object.hpp"
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#pragma once
+
+// Spectator stream: what observers need to follow a match, published once per tick.
+//
+// Every frame is a varint byte length followed by the body. A keyframe carries the
+// whole Snapshot; the frames in between only carry what changed since the previous
+// tick. Coordinates are quantized to 1/16 pixel and written as zigzag varints, so a
+// tick where nothing moves costs a few bytes. The server encodes each tick once and
+// queues the same buffer to every subscriber, a late subscriber gets the last
+// keyframe and the deltas after it.
+//
+// Body, all integers varint:
+//     tick, kind (0 keyframe, 1 delta)
+//     keyframe: state, active side, magenta life, cyan life, aim flags,
+//               aim origin x y, aim destination x y, then per team:
+//               pawn count, x y of every pawn
+//     delta:    changed (1 header, 2 aim, 4 magenta pawns, 8 cyan pawns), then
+//               the header fields and/or the aim coordinates as differences if changed,
+//               per changed team: pawn count, changed pawn count, then for every
+//               changed pawn its index gap to the previous one and x y differences
+//
+// A pawn count is at most max_pawns, the decoder refuses a frame claiming more rather
+// than allocate for it.
+
+namespace spectator {
+const int keyframe_interval = 30; // ticks, one second at the game's 30 Hz
+const float quantum = 1.f / 16;
+const std::uint32_t max_pawns = 1 << 16; // per team, far more than a match reaches
+
+struct Snapshot
+{
+    std::uint32_t tick = 0;
+    std::uint32_t state = 0;
+    std::uint32_t active_side = 0;
+    std::uint32_t lives[2] = {0, 0};
+    std::uint32_t aim_flags = 0; // 1 reach circle, 2 direction sign
+    std::int32_t aim[4] = {0, 0, 0, 0}; // origin x y, destination x y
+    std::vector<std::int32_t> pawns[2]; // x y of every pawn, magenta then cyan
+
+    bool operator==(const Snapshot &other) const;
+};
+
+using Frame = std::vector<unsigned char>;
+
+std::int32_t Quantize(float coordinate);
+float Dequantize(std::int32_t coordinate);
+Snapshot Capture(const Match &match, std::uint32_t tick, std::uint32_t state, const Aim &aim);
+
+class Encoder
+{
+public:
+    std::shared_ptr<const Frame> Encode(const Snapshot &snapshot);
+    bool Keyframe() const { return keyframe; }
+
+private:
+    Snapshot previous;
+    std::uint32_t encoded = 0;
+    bool keyframe = false;
+};
+
+class Decoder
+{
+public:
+    bool Apply(const unsigned char *body, std::size_t size);
+    bool Ready() const { return ready; }
+    const Snapshot &Current() const { return current; }
+
+private:
+    Snapshot current;
+    bool ready = false;
+};
+
+class Server
+{
+public:
+    bool Open(int port, std::string &error) { return listener.Open(port, error); }
+    int Port() const { return listener.Port(); }
+
+    void Publish(const Snapshot &snapshot);
+
+    std::size_t Subscriber_count() const { return subscribers.size(); }
+    std::size_t Dropped() const { return dropped; }
+    const Frame &Last_frame() const { return *history.back(); }
+    bool Last_was_keyframe() const { return encoder.Keyframe(); }
+
+private:
+    struct Subscriber
+    {
+        net::Connection connection;
+        std::deque<std::shared_ptr<const Frame>> queue;
+        std::size_t offset = 0; // into queue.front()
+    };
+
+    void Accept();
+    bool Flush(Subscriber &subscriber);
+
+    net::Listener listener;
+    Encoder encoder;
+    std::vector<std::shared_ptr<const Frame>> history; // last keyframe and the deltas after it
+    std::vector<Subscriber> subscribers;
+    std::size_t dropped = 0;
+};
+
+class Client
+{
+public:
+    bool Connect(const std::string &host, int port, std::string &error)
+    {
+        return connection.Connect(host, port, error);
+    }
+
+    bool Poll(int timeout_ms = 0);
+
+    const Decoder &Stream() const { return decoder; }
+    std::size_t Bytes_received() const { return bytes_received; }
+    std::size_t Frames() const { return frames; }
+    bool Failed() const { return failed; }
+
+private:
+    net::Connection connection;
+    Decoder decoder;
+    std::vector<unsigned char> pending;
+    std::size_t bytes_received = 0;
+    std::size_t frames = 0;
+    bool failed = false;
+};
+}; // namespace spectator
+
+namespace {
+void Put_varint(spectator::Frame &frame, std::uint32_t value)
+{
+    while (value >= 0x80) {
+        frame.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+
+    frame.push_back(static_cast<unsigned char>(value));
+}
+
+void Put_signed(spectator::Frame &frame, std::int32_t value)
+{
+    Put_varint(frame, (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31));
+}
+
+bool Get_varint(const unsigned char *&bytes, const unsigned char *end, std::uint32_t &value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 35 && bytes != end; shift += 7) {
+        value |= static_cast<std::uint32_t>(*bytes & 0x7F) << shift;
+
+        if ((*bytes++ & 0x80) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+bool Get_signed(const unsigned char *&bytes, const unsigned char *end, std::int32_t &value)
+{
+    std::uint32_t zigzag;
+
+    if (!Get_varint(bytes, end, zigzag))
+        return false;
+
+    value = static_cast<std::int32_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+
+    return true;
+}
+} // namespace
+
+bool spectator::Snapshot::operator==(const Snapshot &other) const
+{
+    return tick == other.tick && state == other.state && active_side == other.active_side
+           && lives[0] == other.lives[0] && lives[1] == other.lives[1] && aim_flags == other.aim_flags
+           && std::equal(aim, aim + 4, other.aim) && pawns[0] == other.pawns[0]
+           && pawns[1] == other.pawns[1];
+}
+
+std::int32_t spectator::Quantize(float coordinate)
+{
+    return static_cast<std::int32_t>(lroundf(coordinate / quantum));
+}
+
+float spectator::Dequantize(std::int32_t coordinate)
+{
+    return coordinate * quantum;
+}
+
+spectator::Snapshot spectator::Capture(const Match &match,
+                                       std::uint32_t tick,
+                                       std::uint32_t state,
+                                       const Aim &aim)
+{
+    Snapshot snapshot;
+    snapshot.tick = tick;
+    snapshot.state = state;
+    snapshot.active_side = match.Active_side();
+    snapshot.lives[0] = match.King_of(0).Life();
+    snapshot.lives[1] = match.King_of(1).Life();
+    snapshot.aim_flags = (aim.Visible() ? 1 : 0) | (aim.Direction_visible() ? 2 : 0);
+    snapshot.aim[0] = Quantize(aim.Center().X());
+    snapshot.aim[1] = Quantize(aim.Center().Y());
+    snapshot.aim[2] = Quantize(aim.Pawn_destination().X());
+    snapshot.aim[3] = Quantize(aim.Pawn_destination().Y());
+
+    // the stream carries two teams, Option keeps spectators out of free for all
+    for (const Pawn &pawn : match.Pawns()) {
+        snapshot.pawns[pawn.Team()].push_back(Quantize(pawn.Center().X()));
+        snapshot.pawns[pawn.Team()].push_back(Quantize(pawn.Center().Y()));
+    }
+
+    return snapshot;
+}
+
+std::shared_ptr<const spectator::Frame> spectator::Encoder::Encode(const Snapshot &snapshot)
+{
+    Frame body;
+    keyframe = encoded % keyframe_interval == 0;
+    encoded++;
+
+    Put_varint(body, snapshot.tick);
+    Put_varint(body, keyframe ? 0 : 1);
+
+    if (keyframe) {
+        for (std::uint32_t field : {snapshot.state,
+                                    snapshot.active_side,
+                                    snapshot.lives[0],
+                                    snapshot.lives[1],
+                                    snapshot.aim_flags})
+            Put_varint(body, field);
+
+        for (std::int32_t coordinate : snapshot.aim)
+            Put_signed(body, coordinate);
+
+        for (const auto &pawns : snapshot.pawns) {
+            Put_varint(body, pawns.size() / 2);
+
+            for (std::int32_t coordinate : pawns)
+                Put_signed(body, coordinate);
+        }
+    } else {
+        bool header_changed = snapshot.state != previous.state
+                              || snapshot.active_side != previous.active_side
+                              || snapshot.lives[0] != previous.lives[0]
+                              || snapshot.lives[1] != previous.lives[1]
+                              || snapshot.aim_flags != previous.aim_flags;
+        bool aim_changed = !std::equal(snapshot.aim, snapshot.aim + 4, previous.aim);
+        std::uint32_t changed = (header_changed ? 1 : 0) | (aim_changed ? 2 : 0);
+
+        for (int team = 0; team < 2; team++)
+            if (snapshot.pawns[team] != previous.pawns[team])
+                changed |= 4 << team;
+
+        Put_varint(body, changed);
+
+        if (header_changed)
+            for (std::uint32_t field : {snapshot.state,
+                                        snapshot.active_side,
+                                        snapshot.lives[0],
+                                        snapshot.lives[1],
+                                        snapshot.aim_flags})
+                Put_varint(body, field);
+
+        if (aim_changed)
+            for (int i = 0; i < 4; i++)
+                Put_signed(body, snapshot.aim[i] - previous.aim[i]);
+
+        for (int team = 0; team < 2; team++) {
+            if ((changed & (4 << team)) == 0)
+                continue;
+
+            const std::vector<std::int32_t> &now = snapshot.pawns[team];
+            const std::vector<std::int32_t> &before = previous.pawns[team];
+            auto old = [&](std::size_t i) { return i < before.size() ? before[i] : 0; };
+
+            std::vector<std::size_t> moved;
+
+            for (std::size_t i = 0; i < now.size(); i += 2)
+                if (now[i] != old(i) || now[i + 1] != old(i + 1))
+                    moved.push_back(i / 2);
+
+            Put_varint(body, now.size() / 2);
+            Put_varint(body, moved.size());
+
+            std::size_t last = 0;
+
+            for (std::size_t pawn : moved) {
+                Put_varint(body, pawn - last);
+                Put_signed(body, now[pawn * 2] - old(pawn * 2));
+                Put_signed(body, now[pawn * 2 + 1] - old(pawn * 2 + 1));
+                last = pawn;
+            }
+        }
+    }
+
+    previous = snapshot;
+
+    auto frame = std::make_shared<Frame>();
+    frame->reserve(body.size() + 5);
+    Put_varint(*frame, body.size());
+    frame->insert(frame->end(), body.begin(), body.end());
+
+    return frame;
+}
+
+bool spectator::Decoder::Apply(const unsigned char *body, std::size_t size)
+// false for a malformed body, or a delta before the first keyframe
+{
+    const unsigned char *end = body + size;
+    std::uint32_t tick;
+    std::uint32_t kind;
+
+    if (!Get_varint(body, end, tick) || !Get_varint(body, end, kind))
+        return false;
+
+    if (kind == 1 && !ready)
+        return false;
+
+    Snapshot next = current;
+    next.tick = tick;
+
+    auto read_header = [&] {
+        return Get_varint(body, end, next.state) && Get_varint(body, end, next.active_side)
+               && Get_varint(body, end, next.lives[0]) && Get_varint(body, end, next.lives[1])
+               && Get_varint(body, end, next.aim_flags);
+    };
+
+    if (kind == 0) {
+        if (!read_header())
+            return false;
+
+        for (std::int32_t &coordinate : next.aim)
+            if (!Get_signed(body, end, coordinate))
+                return false;
+
+        for (auto &pawns : next.pawns) {
+            std::uint32_t count;
+
+            // every coordinate takes at least a byte, a count beyond the body is a lie
+            if (!Get_varint(body, end, count) || count > max_pawns
+                || count > static_cast<std::size_t>(end - body) / 2)
+                return false;
+
+            pawns.resize(count * 2);
+
+            for (std::int32_t &coordinate : pawns)
+                if (!Get_signed(body, end, coordinate))
+                    return false;
+        }
+    } else {
+        std::uint32_t changed;
+
+        if (!Get_varint(body, end, changed))
+            return false;
+
+        if ((changed & 1) && !read_header())
+            return false;
+
+        if (changed & 2)
+            for (std::int32_t &coordinate : next.aim) {
+                std::int32_t difference;
+
+                if (!Get_signed(body, end, difference))
+                    return false;
+
+                coordinate += difference;
+            }
+
+        for (int team = 0; team < 2; team++) {
+            if ((changed & (4 << team)) == 0)
+                continue;
+
+            std::uint32_t count;
+            std::uint32_t moved;
+
+            // pawns that did not move cost no bytes, so only max_pawns bounds the count
+            if (!Get_varint(body, end, count) || !Get_varint(body, end, moved)
+                || count > max_pawns || moved > count)
+                return false;
+
+            next.pawns[team].resize(count * 2, 0);
+
+            std::uint32_t pawn = 0;
+
+            for (std::uint32_t i = 0; i < moved; i++) {
+                std::uint32_t gap;
+                std::int32_t dx;
+                std::int32_t dy;
+
+                if (!Get_varint(body, end, gap) || !Get_signed(body, end, dx)
+                    || !Get_signed(body, end, dy) || (pawn += gap) >= count)
+                    return false;
+
+                next.pawns[team][pawn * 2] += dx;
+                next.pawns[team][pawn * 2 + 1] += dy;
+            }
+        }
+    }
+
+    current = std::move(next);
+    ready = true;
+
+    return true;
+}
+
+void spectator::Server::Publish(const Snapshot &snapshot)
+// encode once, hand the same buffer to every subscriber, send what each socket takes
+{
+    Accept();
+
+    std::shared_ptr<const Frame> frame = encoder.Encode(snapshot);
+
+    if (encoder.Keyframe())
+        history.clear();
+
+    history.push_back(frame);
+
+    for (auto it = subscribers.begin(); it != subscribers.end();) {
+        it->queue.push_back(frame);
+
+        // more than a second behind: the subscriber cannot keep up, let it reconnect
+        if (it->queue.size() > static_cast<std::size_t>(keyframe_interval) || !Flush(*it)) {
+            it = subscribers.erase(it);
+            dropped++;
+        } else
+            ++it;
+    }
+}
+
+void spectator::Server::Accept()
+{
+    Subscriber subscriber;
+
+    while (listener.Poll(subscriber.connection, 0)) {
+        subscriber.connection.Blocking(false);
+        subscriber.queue.assign(history.begin(), history.end());
+        subscriber.offset = 0;
+
+        if (Flush(subscriber))
+            subscribers.push_back(std::move(subscriber));
+
+        subscriber = Subscriber();
+    }
+}
+
+bool spectator::Server::Flush(Subscriber &subscriber)
+// false once the connection is gone
+{
+    while (!subscriber.queue.empty()) {
+        const Frame &frame = *subscriber.queue.front();
+        int sent = subscriber.connection.Send_some(frame.data() + subscriber.offset,
+                                                   frame.size() - subscriber.offset);
+
+        if (sent < 0)
+            return false;
+
+        if (sent == 0)
+            return true;
+
+        subscriber.offset += sent;
+
+        if (subscriber.offset == frame.size()) {
+            subscriber.queue.pop_front();
+            subscriber.offset = 0;
+        }
+    }
+
+    return true;
+}
+
+bool spectator::Client::Poll(int timeout_ms)
+// read what has arrived and decode every complete frame, true if any was decoded
+{
+    std::size_t decoded = frames;
+    unsigned char buffer[4096];
+
+    while (!failed) {
+        int received = connection.Receive(buffer, sizeof(buffer), timeout_ms);
+
+        if (received < 0)
+            failed = true;
+
+        if (received <= 0)
+            break;
+
+        bytes_received += received;
+        pending.insert(pending.end(), buffer, buffer + received);
+        timeout_ms = 0;
+    }
+
+    const unsigned char *bytes = pending.data();
+    const unsigned char *end = bytes + pending.size();
+
+    while (bytes != end) {
+        const unsigned char *frame_start = bytes;
+        std::uint32_t size;
+
+        if (!Get_varint(bytes, end, size) || static_cast<std::size_t>(end - bytes) < size) {
+            bytes = frame_start;
+            break;
+        }
+
+        // a stream joined mid-way starts at a keyframe, anything else is corrupt
+        if (!decoder.Apply(bytes, size)) {
+            failed = true;
+            break;
+        }
+
+        bytes += size;
+        frames++;
+    }
+
+    pending.erase(pending.begin(), pending.begin() + (bytes - pending.data()));
+
+    return frames != decoded;
+}
@@ -0,0 +1,188 @@
+#include "map_generator.hpp"
+#include "match.hpp"
+#include "object.hpp"
+#include "option.hpp"
+#include "spectator.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// spectator_load [--clients count] [--ticks count] [--seed seed] [game options ...]
+//     stream a match played by random turns to count loopback spectators, half of
+//     them joining mid-stream, then check that every spectator decoded the last tick
+//     exactly and report the bandwidth.
+//     Game options (--generate, --map, --world-scale, ...) pick the map.
+
+double Microseconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+int main(int argc, char **argv)
+{
+    int client_count = 300;
+    int ticks = 3000;
+    std::uint64_t seed = 1;
+    std::vector<char *> game_arguments{argv[0]};
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (argument == "--clients" && has_value)
+            client_count = std::stoi(argv[++i]);
+
+        else if (argument == "--ticks" && has_value)
+            ticks = std::stoi(argv[++i]);
+
+        else if (argument == "--seed" && has_value)
+            seed = std::stoull(argv[++i]);
+
+        else
+            game_arguments.push_back(argv[i]);
+    }
+
+    Option option = Option(static_cast<int>(game_arguments.size()), game_arguments.data());
+
+    if (option.Team_count() > 2) {
+        std::cerr << "the spectator stream needs two teams\n";
+        return 1;
+    }
+
+    Match match = Match(option);
+    Aim aim;
+    Random random = Random(seed);
+
+    spectator::Server server;
+    std::string error;
+
+    if (!server.Open(0, error)) {
+        std::cerr << error << '\n';
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<spectator::Client>> clients;
+
+    auto connect = [&](int count) {
+        for (int i = 0; i < count; i++) {
+            clients.push_back(std::make_unique<spectator::Client>());
+
+            if (!clients.back()->Connect("127.0.0.1", server.Port(), error)) {
+                std::cerr << error << " (client " << clients.size() << ")\n";
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    // half the spectators join mid-stream, between two keyframes
+    const int late_tick = ticks / 2 + spectator::keyframe_interval / 2;
+
+    if (!connect(client_count - client_count / 2))
+        return 1;
+
+    // a turn is aimed for a second, like a player would, then shot
+    const int aim_ticks = 30;
+    int aiming = 0;
+    Turn turn;
+
+    double publish_us = 0;
+    double max_publish_us = 0;
+    std::size_t keyframe_bytes = 0;
+    std::size_t keyframes = 0;
+    std::size_t delta_bytes = 0;
+    std::size_t deltas = 0;
+    spectator::Snapshot last;
+
+    for (int tick = 0; tick < ticks; tick++) {
+        std::uint32_t state = 0;
+
+        if (tick == late_tick && !connect(client_count / 2))
+            return 1;
+
+        if (match.Over())
+            match.Reset();
+
+        if (match.Shooting()) {
+            match.Step();
+            state = 2;
+        } else if (aiming == 0) {
+            turn = Random_turn(match, random);
+            aim.Center(turn.origin);
+            aim.Show_reach_circle();
+            aiming = aim_ticks;
+            state = 1;
+        } else if (--aiming == 0) {
+            aim.Hide();
+            match.Fire(turn);
+            state = 2;
+        } else {
+            // the mouse sits opposite the destination, drifting until it settles
+            aim.Update_direction(turn.origin * 2 - turn.destination
+                                 + Vector(0, aiming * param::unit_length));
+            aim.Show_direction_sign();
+            state = 1;
+        }
+
+        last = spectator::Capture(match, tick, state, aim);
+
+        auto start = std::chrono::steady_clock::now();
+        server.Publish(last);
+        double elapsed = Microseconds_since(start);
+
+        publish_us += elapsed;
+        max_publish_us = std::max(max_publish_us, elapsed);
+
+        if (server.Last_was_keyframe())
+            keyframe_bytes += server.Last_frame().size(), keyframes++;
+        else
+            delta_bytes += server.Last_frame().size(), deltas++;
+
+        for (auto &client : clients)
+            client->Poll();
+    }
+
+    // the last frames may still be in flight on loopback
+    int in_sync = 0;
+    int failed = 0;
+
+    for (auto &client : clients) {
+        for (int attempt = 0; attempt < 100 && client->Stream().Current().tick != last.tick
+                              && !client->Failed();
+             attempt++)
+            client->Poll(10);
+
+        if (client->Failed())
+            failed++;
+        else if (client->Stream().Ready() && client->Stream().Current() == last)
+            in_sync++;
+    }
+
+    std::size_t received = 0;
+
+    for (const auto &client : clients)
+        received += client->Bytes_received();
+
+    double seconds_at_30_hz = ticks / 30.0;
+
+    std::cout << std::fixed << std::setprecision(1) << "clients             " << client_count
+              << " (" << server.Subscriber_count() << " subscribed, " << server.Dropped()
+              << " dropped, " << failed << " failed)\n"
+              << "ticks               " << ticks << '\n'
+              << "keyframe            " << static_cast<double>(keyframe_bytes) / std::max<std::size_t>(keyframes, 1)
+              << " bytes average, " << keyframes << " sent\n"
+              << "delta               " << static_cast<double>(delta_bytes) / std::max<std::size_t>(deltas, 1)
+              << " bytes average, " << deltas << " sent\n"
+              << "per client          " << received / static_cast<double>(client_count) / seconds_at_30_hz
+              << " bytes/s at 30 Hz, late joiners counted over the whole run\n"
+              << "publish             " << publish_us / ticks << " us/tick average, " << max_publish_us
+              << " us worst, " << publish_us / ticks / client_count * 1000 << " ns per client\n"
+              << "decoded last tick   " << in_sync << " of " << client_count << " clients\n";
+
+    return in_sync == client_count ? 0 : 1;
+}
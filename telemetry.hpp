@@ -0,0 +1,320 @@
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#pragma once
+
+// Live counters of a running game in POSIX shared memory.
+//
+// The game maps a fixed layout Block and writes a Sample into it once a frame; any
+// number of processes map it read only and take copies whenever they like. Nothing
+// is shared but the memory: the game never waits for a reader and never knows of one.
+//
+// The Sample is guarded by a sequence lock: the writer makes the sequence odd, stores
+// the words, then makes it even again. A reader copies the words between two loads of
+// the sequence and keeps the copy only if both loads are the same even value, else it
+// tries again. Every word is a lock-free 64-bit atomic, so a copy torn by the writer is
+// detected rather than undefined, and works the same in any process mapping it.
+//
+// A name is published by one game at a time: Open fails while the game that wrote the
+// block is still running, and takes over a block left by one that crashed.
+//
+// Not available on Windows, where Open fails.
+
+namespace telemetry {
+const char magic[8] = {'M', 'F', 'G', 'T', 'E', 'L', 'E', 'M'};
+const std::uint32_t version = 1;
+
+constexpr int max_teams = 16; // param::max_teams, without needing allegro
+
+struct Sample
+// one frame of the game; plain data, the layout is the format
+{
+    std::uint64_t frame;
+    std::uint64_t tick;              // simulation ticks since the start
+    double frame_ms;                 // between the last two frames shown
+    double ticks_per_second;         // over the last second or so
+    char state[16];                  // To_string of the game's State
+    std::uint32_t turn;              // turns fired in this match
+    std::uint32_t team_count;
+    std::uint32_t pawns[max_teams];  // on the board, per team
+    std::uint64_t collision_tests;   // narrowphase tests during the last tick
+    std::uint64_t collision_hits;    // of those, the ones that found a contact
+    std::uint64_t allocations;       // during the last frame, 0 unless built with ALLOC_TRACKING
+    std::uint64_t allocated_bytes;
+};
+
+constexpr std::size_t sample_words = sizeof(Sample) / sizeof(std::uint64_t);
+
+static_assert(sizeof(Sample) % sizeof(std::uint64_t) == 0, "Sample must be whole words");
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared atomics must be lock-free");
+
+struct Block
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t sample_size;
+    std::int64_t pid;                    // of the game, to tell a stale block
+    std::atomic<std::uint64_t> sequence; // odd while the game writes, +2 per Sample
+    std::atomic<std::uint64_t> words[sample_words];
+};
+
+class Publisher
+// the game's side; Open creates the object, Close removes it
+{
+public:
+    Publisher() = default;
+    ~Publisher() { Close(); }
+
+    Publisher(const Publisher &) = delete;
+    Publisher &operator=(const Publisher &) = delete;
+
+    bool Open(const std::string &name, std::string &error);
+    void Close();
+    void Publish(const Sample &sample);
+
+    const std::string &Name() const { return name; }
+
+private:
+    Block *block = nullptr;
+    std::string name;
+};
+
+class Reader
+// a monitor's side, read only
+{
+public:
+    Reader() = default;
+    ~Reader() { Close(); }
+
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    bool Open(const std::string &name, std::string &error);
+    void Close();
+    bool Read(Sample &sample, std::uint64_t &sequence, int &retries) const;
+
+    std::int64_t Pid() const { return block->pid; }
+
+private:
+    const Block *block = nullptr;
+};
+
+std::string Object_name(const std::string &name);
+}; // namespace telemetry
+
+std::string telemetry::Object_name(const std::string &name)
+// shared memory names start with a slash
+{
+    return name.empty() || name[0] != '/' ? '/' + name : name;
+}
+
+bool telemetry::Publisher::Open(const std::string &name, std::string &error)
+{
+    Close();
+
+#ifdef _WIN32
+    error = "telemetry needs POSIX shared memory";
+    return false;
+#else
+    std::string object = Object_name(name);
+
+    // only an object created here is removed again if this fails, one that existed may
+    // belong to a running game
+    bool created = true;
+    int descriptor = shm_open(object.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+
+    if (descriptor < 0 && errno == EEXIST) {
+        created = false;
+        descriptor = shm_open(object.c_str(), O_RDWR, 0);
+    }
+
+    if (descriptor < 0) {
+        error = "cannot open shared memory " + object;
+        return false;
+    }
+
+    auto fail = [&](const std::string &why) {
+        close(descriptor);
+
+        if (created)
+            shm_unlink(object.c_str());
+
+        error = why + " " + object;
+        return false;
+    };
+
+    struct stat status;
+
+    if (fstat(descriptor, &status) != 0)
+        return fail("cannot read shared memory");
+
+    if (static_cast<std::size_t>(status.st_size) != sizeof(Block)
+        && ftruncate(descriptor, sizeof(Block)) != 0)
+        return fail("cannot size shared memory");
+
+    void *mapping = mmap(nullptr, sizeof(Block), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+
+    if (mapping == MAP_FAILED)
+        return fail("cannot map shared memory");
+
+    close(descriptor);
+
+    block = static_cast<Block *>(mapping);
+
+    if (std::memcmp(block->magic, magic, sizeof(magic)) == 0 && block->pid > 0
+        && block->pid != getpid()
+        && (kill(static_cast<pid_t>(block->pid), 0) == 0 || errno == EPERM)) {
+        error = object + " is published by the running process " + std::to_string(block->pid);
+        munmap(block, sizeof(Block));
+        block = nullptr;
+        return false;
+    }
+
+    // a block left by a game that is gone is taken over; the magic goes in last, so a
+    // reader never accepts a header being written
+    std::memset(block->magic, 0, sizeof(block->magic));
+    block->version = version;
+    block->sample_size = sizeof(Sample);
+    block->pid = getpid();
+    block->sequence.store(0, std::memory_order_relaxed);
+
+    for (std::atomic<std::uint64_t> &word : block->words)
+        word.store(0, std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(block->magic, magic, sizeof(magic));
+    this->name = object;
+
+    return true;
+#endif
+}
+
+void telemetry::Publisher::Close()
+// readers still mapping it keep the last Sample
+{
+    if (!block)
+        return;
+
+#ifndef _WIN32
+    munmap(block, sizeof(Block));
+    shm_unlink(name.c_str());
+#endif
+
+    block = nullptr;
+    name.clear();
+}
+
+void telemetry::Publisher::Publish(const Sample &sample)
+// a few dozen relaxed stores, it never waits
+{
+    if (!block)
+        return;
+
+    std::uint64_t words[sample_words];
+    std::memcpy(words, &sample, sizeof(Sample));
+
+    std::uint64_t sequence = block->sequence.load(std::memory_order_relaxed);
+    block->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (std::size_t i = 0; i < sample_words; i++)
+        block->words[i].store(words[i], std::memory_order_relaxed);
+
+    block->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool telemetry::Reader::Open(const std::string &name, std::string &error)
+{
+    Close();
+
+#ifdef _WIN32
+    error = "telemetry needs POSIX shared memory";
+    return false;
+#else
+    std::string object = Object_name(name);
+    int descriptor = shm_open(object.c_str(), O_RDONLY, 0);
+
+    if (descriptor < 0) {
+        error = "no game publishes " + object;
+        return false;
+    }
+
+    struct stat status;
+
+    if (fstat(descriptor, &status) != 0
+        || static_cast<std::size_t>(status.st_size) < sizeof(Block)) {
+        close(descriptor);
+        error = object + " is not a telemetry block";
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, sizeof(Block), PROT_READ, MAP_SHARED, descriptor, 0);
+    close(descriptor);
+
+    if (mapping == MAP_FAILED) {
+        error = "cannot map shared memory " + object;
+        return false;
+    }
+
+    block = static_cast<const Block *>(mapping);
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (std::memcmp(block->magic, magic, sizeof(magic)) != 0 || block->version != version
+        || block->sample_size != sizeof(Sample)) {
+        Close();
+        error = object + " is not a telemetry block of this version";
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+void telemetry::Reader::Close()
+{
+    if (!block)
+        return;
+
+#ifndef _WIN32
+    munmap(const_cast<Block *>(block), sizeof(Block));
+#endif
+
+    block = nullptr;
+}
+
+bool telemetry::Reader::Read(Sample &sample, std::uint64_t &sequence, int &retries) const
+// the latest Sample and its sequence; retries counts the copies the game tore, and
+// after a few the read gives up rather than spin against the writer
+{
+    std::uint64_t words[sample_words];
+
+    for (retries = 0; retries < 16; retries++) {
+        std::uint64_t before = block->sequence.load(std::memory_order_acquire);
+
+        if (before & 1)
+            continue;
+
+        for (std::size_t i = 0; i < sample_words; i++)
+            words[i] = block->words[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (block->sequence.load(std::memory_order_relaxed) != before)
+            continue;
+
+        std::memcpy(&sample, words, sizeof(Sample));
+        sequence = before;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,183 @@
+#include "telemetry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#endif
+
+// telemetry_reader [--name /my_first_game] [--rate hz] [--print seconds] [--seconds seconds]
+//                  [--csv]
+//     sample the telemetry of a game started with --telemetry name, rate times a second
+//     (1000 by default), and print a summary line every --print seconds: the latest
+//     sample, how many new samples were seen and how many reads the game tore. --csv
+//     prints every new sample as a row instead. Stops after --seconds, or when the game
+//     has exited.
+//
+// The reader shares nothing with the game but the memory, see telemetry.hpp: it can
+// sample as often as it likes without the game ever waiting for it.
+
+struct Settings
+{
+    std::string name = "/my_first_game";
+    double rate = 1000;
+    double print = 0.5;
+    double seconds = 0; // until the game exits
+    bool csv = false;
+};
+
+bool Game_exited(const telemetry::Reader &reader)
+{
+#ifdef _WIN32
+    return false;
+#else
+    return kill(static_cast<pid_t>(reader.Pid()), 0) != 0 && errno == ESRCH;
+#endif
+}
+
+void Print_header(const Settings &settings)
+{
+    if (!settings.csv)
+        return;
+
+    std::cout << "sequence,frame,tick,frame_ms,ticks_per_second,state,turn,collision_tests,"
+                 "collision_hits,allocations,allocated_bytes";
+
+    for (int team = 0; team < telemetry::max_teams; team++)
+        std::cout << ",pawns_" << team;
+
+    std::cout << '\n';
+}
+
+void Print_row(std::uint64_t sequence, const telemetry::Sample &sample)
+{
+    std::cout << sequence / 2 << ',' << sample.frame << ',' << sample.tick << ',' << sample.frame_ms
+              << ',' << sample.ticks_per_second << ',' << sample.state << ',' << sample.turn << ','
+              << sample.collision_tests << ',' << sample.collision_hits << ',' << sample.allocations
+              << ',' << sample.allocated_bytes;
+
+    for (std::uint32_t pawns : sample.pawns)
+        std::cout << ',' << pawns;
+
+    std::cout << '\n';
+}
+
+void Print_summary(const telemetry::Sample &sample,
+                   std::uint64_t reads,
+                   std::uint64_t updates,
+                   std::uint64_t torn)
+{
+    char line[256];
+
+    std::snprintf(line, sizeof(line),
+                  "frame %llu  %6.2f ms  %5.1f ticks/s  %-14s turn %u  tests %llu  hits %llu  "
+                  "allocs %llu  pawns",
+                  static_cast<unsigned long long>(sample.frame), sample.frame_ms,
+                  sample.ticks_per_second, sample.state, sample.turn,
+                  static_cast<unsigned long long>(sample.collision_tests),
+                  static_cast<unsigned long long>(sample.collision_hits),
+                  static_cast<unsigned long long>(sample.allocations));
+    std::cout << line;
+
+    for (std::uint32_t team = 0; team < sample.team_count && team < telemetry::max_teams; team++)
+        std::cout << ' ' << sample.pawns[team];
+
+    std::cout << "  (" << reads << " reads, " << updates << " new, " << torn << " torn)"
+              << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    Settings settings;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (argument == "--name" && has_value)
+            settings.name = argv[++i];
+
+        else if (argument == "--rate" && has_value)
+            settings.rate = std::max(1.0, std::stod(argv[++i]));
+
+        else if (argument == "--print" && has_value)
+            settings.print = std::stod(argv[++i]);
+
+        else if (argument == "--seconds" && has_value)
+            settings.seconds = std::stod(argv[++i]);
+
+        else if (argument == "--csv")
+            settings.csv = true;
+
+        else
+            std::cerr << "ignoring unknown option " << argument << '\n';
+    }
+
+    telemetry::Reader reader;
+    std::string error;
+
+    if (!reader.Open(settings.name, error)) {
+        std::cerr << error << '\n';
+        return 1;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto to_clock = [](double seconds) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    };
+
+    const auto period = to_clock(1 / settings.rate);
+    const auto start = Clock::now();
+    auto next_read = start;
+    auto next_print = start;
+
+    telemetry::Sample sample{};
+    std::uint64_t last_sequence = 0;
+    std::uint64_t reads = 0;
+    std::uint64_t updates = 0;
+    std::uint64_t torn = 0;
+    std::uint64_t loops = 0;
+
+    Print_header(settings);
+
+    while (settings.seconds <= 0
+           || std::chrono::duration<double>(Clock::now() - start).count() < settings.seconds) {
+        std::uint64_t sequence = 0;
+        int retries = 0;
+
+        if (reader.Read(sample, sequence, retries)) {
+            reads++;
+
+            if (sequence != last_sequence) {
+                updates++;
+                last_sequence = sequence;
+
+                if (settings.csv)
+                    Print_row(sequence, sample);
+            }
+        }
+
+        torn += retries;
+
+        if (!settings.csv && Clock::now() >= next_print) {
+            Print_summary(sample, reads, updates, torn);
+            next_print += to_clock(settings.print);
+            reads = updates = torn = 0;
+        }
+
+        // checked now and then, it costs a system call
+        if (++loops % 1024 == 0 && Game_exited(reader)) {
+            std::cerr << "the game has exited\n";
+            break;
+        }
+
+        next_read += period;
+        std::this_thread::sleep_until(next_read);
+    }
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "geometry.hpp"
+#include <allegro5/allegro_font.h>
+#include <allegro5/allegro_primitives.h>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+#pragma once
+
+// Text that changes every frame: scores, timers, profiler numbers.
+//
+// The printable ASCII glyphs of a font are drawn once into one atlas bitmap. A Batch
+// collects the text of a frame as textured quads over that atlas, from any number of
+// Add calls, and Draw hands them to al_draw_prim in one call, whatever the number of
+// labels; nothing is allocated once the vertex buffer has grown to a frame's worth.
+// Dialog boxes, whose strings do not change, keep their own per string atlas.
+
+namespace text {
+class Glyph_atlas
+{
+public:
+    explicit Glyph_atlas(const ALLEGRO_FONT *const font);
+    ~Glyph_atlas() { al_destroy_bitmap(bitmap); }
+
+    Glyph_atlas(const Glyph_atlas &) = delete;
+    Glyph_atlas &operator=(const Glyph_atlas &) = delete;
+
+    struct Glyph
+    {
+        float u; // left of the glyph in the atlas, in pixels as al_draw_prim wants
+        float v;
+        float width;
+    };
+
+    static constexpr int first = ' ';
+    static constexpr int last = '~';
+
+    const Glyph &Of(char c) const
+    // anything outside printable ASCII shows as '?'
+    {
+        int code = static_cast<unsigned char>(c);
+        return glyphs[code >= first && code <= last ? code - first : '?' - first];
+    }
+
+    float Line_height() const { return line_height; }
+    ALLEGRO_BITMAP *Bitmap() const { return bitmap; }
+
+private:
+    ALLEGRO_BITMAP *bitmap;
+    float line_height;
+    std::array<Glyph, last - first + 1> glyphs;
+};
+
+class Batch
+{
+public:
+    explicit Batch(const Glyph_atlas &atlas)
+        : atlas{atlas}
+    {}
+
+    // both return the width added, where the next piece of the line starts
+    float Add(const Vector &origin, std::string_view text, const ALLEGRO_COLOR &color);
+    float Add(const Vector &origin, double number, int decimals, const ALLEGRO_COLOR &color);
+    void Draw();
+
+    float Width(std::string_view text) const;
+    std::size_t Glyph_count() const { return vertices.size() / 6; }
+
+private:
+    const Glyph_atlas &atlas;
+    std::vector<ALLEGRO_VERTEX> vertices; // two triangles per glyph, kept between frames
+};
+}; // namespace text
+
+text::Glyph_atlas::Glyph_atlas(const ALLEGRO_FONT *const font)
+    : bitmap{nullptr}
+    , line_height{static_cast<float>(al_get_font_line_height(font))}
+    , glyphs{}
+{
+    // one row, a pixel apart so filtering never reaches the neighbour
+    int width = 0;
+
+    for (int code = first; code <= last; code++)
+        width += al_get_glyph_advance(font, code, ALLEGRO_NO_KERNING) + 1;
+
+    ALLEGRO_STATE state;
+    al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP);
+
+    bitmap = al_create_bitmap(width, static_cast<int>(line_height));
+
+    if (!bitmap) {
+        al_restore_state(&state);
+        return;
+    }
+
+    al_set_target_bitmap(bitmap);
+    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+
+    float u = 0;
+
+    for (int code = first; code <= last; code++) {
+        float advance = al_get_glyph_advance(font, code, ALLEGRO_NO_KERNING);
+
+        // full white, so the vertex color is the color on screen
+        al_draw_glyph(font, al_map_rgb_f(1, 1, 1), u, 0, code);
+        glyphs[code - first] = {u, 0, advance};
+        u += advance + 1;
+    }
+
+    al_restore_state(&state);
+}
+
+float text::Batch::Add(const Vector &origin, std::string_view text, const ALLEGRO_COLOR &color)
+// one line from origin, the top left of its first glyph
+{
+    const float height = atlas.Line_height();
+    float x = origin.X();
+    float y = origin.Y();
+
+    for (char c : text) {
+        const Glyph_atlas::Glyph &glyph = atlas.Of(c);
+
+        if (c != ' ') {
+            float right = x + glyph.width;
+            float bottom = y + height;
+            float u_right = glyph.u + glyph.width;
+            float v_bottom = glyph.v + height;
+
+            vertices.push_back({x, y, 0, glyph.u, glyph.v, color});
+            vertices.push_back({right, y, 0, u_right, glyph.v, color});
+            vertices.push_back({right, bottom, 0, u_right, v_bottom, color});
+            vertices.push_back({x, y, 0, glyph.u, glyph.v, color});
+            vertices.push_back({right, bottom, 0, u_right, v_bottom, color});
+            vertices.push_back({x, bottom, 0, glyph.u, v_bottom, color});
+        }
+
+        x += glyph.width;
+    }
+
+    return x - origin.X();
+}
+
+float text::Batch::Add(const Vector &origin, double number, int decimals, const ALLEGRO_COLOR &color)
+// formatted on the stack, for numbers that change every frame
+{
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%.*f", decimals, number);
+
+    if (length <= 0)
+        return 0;
+
+    return Add(origin, std::string_view(buffer, std::min<std::size_t>(length, sizeof(buffer) - 1)), color);
+}
+
+void text::Batch::Draw()
+// everything added since the last Draw, in one call, then starts the next frame
+{
+    if (!vertices.empty() && atlas.Bitmap())
+        al_draw_prim(vertices.data(),
+                     nullptr,
+                     atlas.Bitmap(),
+                     0,
+                     static_cast<int>(vertices.size()),
+                     ALLEGRO_PRIM_TRIANGLE_LIST);
+
+    vertices.clear();
+}
+
+float text::Batch::Width(std::string_view text) const
+{
+    float width = 0;
+
+    for (char c : text)
+        width += atlas.Of(c).width;
+
+    return width;
+}
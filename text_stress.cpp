@@ -0,0 +1,137 @@
+#include "param.hpp"
+#include "text.hpp"
+#include <allegro5/allegro5.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// text_stress [--labels count] [--frames count]
+//     open a window and draw count labels whose numbers change every frame, first
+//     with one al_draw_text per label, then through one text::Batch, and report the
+//     time spent issuing the text of a frame and the whole frame, flip included.
+//     Turn vsync off in the driver to see more than the refresh rate.
+
+struct Timing
+{
+    double submit_ms = 0; // building and issuing the text
+    double frame_ms = 0;  // and the flip
+};
+
+template <typename Draw_labels>
+Timing Run(ALLEGRO_DISPLAY *display, int frames, Draw_labels draw_labels)
+{
+    Timing timing;
+
+    for (int frame = 0; frame < frames; frame++) {
+        auto start = std::chrono::steady_clock::now();
+
+        al_set_target_backbuffer(display);
+        al_clear_to_color(param::black);
+        draw_labels(frame);
+
+        auto submitted = std::chrono::steady_clock::now();
+        al_flip_display();
+        auto flipped = std::chrono::steady_clock::now();
+
+        timing.submit_ms += std::chrono::duration<double, std::milli>(submitted - start).count();
+        timing.frame_ms += std::chrono::duration<double, std::milli>(flipped - start).count();
+    }
+
+    timing.submit_ms /= frames;
+    timing.frame_ms /= frames;
+
+    return timing;
+}
+
+int main(int argc, char **argv)
+{
+    int label_count = 5000;
+    int frames = 300;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (argument == "--labels" && has_value)
+            label_count = std::stoi(argv[++i]);
+
+        else if (argument == "--frames" && has_value)
+            frames = std::stoi(argv[++i]);
+
+        else
+            std::cerr << "ignoring unknown option " << argument << '\n';
+    }
+
+    if (!al_init() || !al_init_primitives_addon()) {
+        std::cerr << "cannot initialize allegro\n";
+        return 1;
+    }
+
+    ALLEGRO_DISPLAY *display = al_create_display(param::window_width, param::window_height);
+
+    if (!display) {
+        std::cerr << "cannot open a display\n";
+        return 1;
+    }
+
+    ALLEGRO_FONT *font = al_create_builtin_font();
+
+    // labels on a grid filling the window, like a dense profiler overlay
+    const float line_height = al_get_font_line_height(font);
+    const int columns = 8;
+    const float column_width = param::window_width / columns;
+    std::vector<Vector> positions;
+
+    for (int i = 0; i < label_count; i++)
+        positions.push_back(Vector((i % columns) * column_width,
+                                   std::fmod((i / columns) * line_height, param::window_height)));
+
+    auto color_of = [](int i) { return param::team_colors[i % param::max_teams]; };
+
+    Timing per_string = Run(display, frames, [&](int frame) {
+        char buffer[32];
+
+        for (int i = 0; i < label_count; i++) {
+            std::snprintf(buffer, sizeof(buffer), "cell %d: %.2f", i, frame * 0.37 + i);
+            al_draw_text(font, color_of(i), positions[i].X(), positions[i].Y(), ALLEGRO_ALIGN_LEFT, buffer);
+        }
+    });
+
+    std::size_t glyphs = 0;
+    Timing batched;
+
+    {
+        text::Glyph_atlas atlas = text::Glyph_atlas(font);
+        text::Batch batch = text::Batch(atlas);
+        // the same text as above, piece by piece
+        batched = Run(display, frames, [&](int frame) {
+            for (int i = 0; i < label_count; i++) {
+                Vector origin = positions[i];
+
+                origin += Vector(batch.Add(origin, "cell ", color_of(i)), 0);
+                origin += Vector(batch.Add(origin, i, 0, color_of(i)), 0);
+                origin += Vector(batch.Add(origin, ": ", color_of(i)), 0);
+                batch.Add(origin, frame * 0.37 + i, 2, color_of(i));
+            }
+
+            glyphs = batch.Glyph_count();
+            batch.Draw();
+        });
+    }
+
+    std::cout << std::fixed << std::setprecision(3) << "labels           " << label_count << " per frame, "
+              << frames << " frames, " << glyphs << " glyphs in the last batch\n"
+              << "al_draw_text     " << per_string.submit_ms << " ms to issue, " << per_string.frame_ms
+              << " ms per frame\n"
+              << "text::Batch      " << batched.submit_ms << " ms to issue, " << batched.frame_ms
+              << " ms per frame\n";
+
+    al_destroy_font(font);
+    al_destroy_display(display);
+
+    return 0;
+}
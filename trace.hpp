@@ -0,0 +1,267 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#pragma once
+
+// Chrome trace (chrome://tracing, ui.perfetto.dev) recorder.
+// Every thread appends to its own buffer; a writer thread swaps the buffers out
+// and streams them to the json file, so recording an event never touches the disk.
+
+namespace trace {
+struct Event
+{
+    const char *name; // must outlive the recorder, string literals are fine
+    const char *category;
+    char phase;
+    std::uint64_t timestamp; // nanoseconds since Start
+};
+
+class Buffer
+{
+public:
+    Buffer(std::uint32_t thread_id)
+        : thread_id{thread_id}
+    {
+        events.reserve(4096);
+    }
+
+    void Push(const Event &event)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        events.push_back(event);
+    }
+
+    void Swap(std::vector<Event> &other)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        events.swap(other);
+    }
+
+    std::uint32_t Thread_id() const { return thread_id; }
+
+private:
+    std::mutex mutex;
+    std::vector<Event> events;
+    const std::uint32_t thread_id;
+};
+
+class Recorder
+{
+public:
+    ~Recorder() { Stop(); }
+
+    bool Start(const std::string &path);
+    void Stop();
+
+    bool Enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    void Record(const char *name, const char *category, char phase);
+
+    static Recorder &Instance()
+    {
+        static Recorder recorder;
+        return recorder;
+    }
+
+private:
+    Recorder() = default;
+
+    Buffer &Thread_buffer();
+    void Write_loop();
+    void Flush();
+
+    std::atomic<bool> enabled{false};
+    std::chrono::steady_clock::time_point start_time;
+    std::ofstream file;
+    bool first_event = true;
+
+    std::mutex buffers_mutex;
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    std::uint32_t next_thread_id = 1;
+
+    std::mutex writer_mutex;
+    std::condition_variable writer_wake;
+    bool writer_should_stop = false;
+    std::thread writer;
+};
+
+bool Start(const std::string &path);
+void Stop();
+bool Enabled();
+void Begin(const char *name, const char *category = "game");
+void End(const char *name, const char *category = "game");
+void Instant(const char *name, const char *category = "game");
+
+class Scope
+{
+public:
+    Scope(const char *name, const char *category = "game")
+        : name{name}
+        , category{category}
+    {
+        Begin(name, category);
+    }
+
+    ~Scope() { End(name, category); }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *name;
+    const char *category;
+};
+}; // namespace trace
+
+bool trace::Recorder::Start(const std::string &path)
+{
+    if (Enabled())
+        return true;
+
+    file.open(path, std::ios::out | std::ios::trunc);
+
+    if (!file)
+        return false;
+
+    file << "{\"traceEvents\":[\n";
+    first_event = true;
+    start_time = std::chrono::steady_clock::now();
+    writer_should_stop = false;
+    writer = std::thread(&Recorder::Write_loop, this);
+    enabled.store(true, std::memory_order_release);
+
+    return true;
+}
+
+void trace::Recorder::Stop()
+{
+    if (!Enabled())
+        return;
+
+    enabled.store(false, std::memory_order_release);
+
+    {
+        std::lock_guard<std::mutex> lock{writer_mutex};
+        writer_should_stop = true;
+    }
+
+    writer_wake.notify_one();
+    writer.join();
+
+    Flush();
+    file << "\n]}\n";
+    file.close();
+}
+
+void trace::Recorder::Record(const char *name, const char *category, char phase)
+{
+    std::uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - start_time)
+                                  .count();
+
+    Thread_buffer().Push(Event{name, category, phase, timestamp});
+}
+
+trace::Buffer &trace::Recorder::Thread_buffer()
+{
+    thread_local std::shared_ptr<Buffer> buffer;
+
+    if (buffer)
+        return *buffer;
+
+    std::lock_guard<std::mutex> lock{buffers_mutex};
+    buffer = std::make_shared<Buffer>(next_thread_id++);
+    buffers.push_back(buffer);
+
+    return *buffer;
+}
+
+void trace::Recorder::Write_loop()
+{
+    std::unique_lock<std::mutex> lock{writer_mutex};
+
+    while (!writer_should_stop) {
+        writer_wake.wait_for(lock, std::chrono::milliseconds(100));
+
+        lock.unlock();
+        Flush();
+        lock.lock();
+    }
+}
+
+void trace::Recorder::Flush()
+// only the writer thread (or Stop after joining it) calls this
+{
+    std::vector<std::shared_ptr<Buffer>> snapshot;
+
+    {
+        std::lock_guard<std::mutex> lock{buffers_mutex};
+        snapshot = buffers;
+    }
+
+    std::vector<Event> events;
+
+    for (const auto &buffer : snapshot) {
+        events.clear();
+        buffer->Swap(events);
+
+        for (const Event &event : events) {
+            if (!first_event)
+                file << ",\n";
+
+            first_event = false;
+
+            file << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+                 << "\",\"ph\":\"" << event.phase << "\",\"ts\":" << event.timestamp / 1000
+                 << '.' << event.timestamp / 100 % 10 << event.timestamp / 10 % 10
+                 << event.timestamp % 10 << ",\"pid\":1,\"tid\":" << buffer->Thread_id();
+
+            if (event.phase == 'i')
+                file << ",\"s\":\"t\"";
+
+            file << '}';
+        }
+    }
+
+    file.flush();
+}
+
+bool trace::Start(const std::string &path)
+{
+    return Recorder::Instance().Start(path);
+}
+
+void trace::Stop()
+{
+    Recorder::Instance().Stop();
+}
+
+bool trace::Enabled()
+{
+    return Recorder::Instance().Enabled();
+}
+
+void trace::Begin(const char *name, const char *category)
+{
+    if (Enabled())
+        Recorder::Instance().Record(name, category, 'B');
+}
+
+void trace::End(const char *name, const char *category)
+{
+    if (Enabled())
+        Recorder::Instance().Record(name, category, 'E');
+}
+
+void trace::Instant(const char *name, const char *category)
+{
+    if (Enabled())
+        Recorder::Instance().Record(name, category, 'i');
+}
@@ -1,63 +1,111 @@
 #include "geometry.hpp"
 #include "param.hpp"
+#include "tween.hpp"
 #include <algorithm>
+#include <cmath>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #pragma once
 
+class Text_atlas
+// every string drawn once, in white, into one bitmap that grows as strings are added;
+// a text on screen is then a tinted blit of its region, which Allegro batches
+{
+public:
+    Text_atlas(const ALLEGRO_FONT *const font)
+        : font{font}
+        , bitmap{nullptr}
+        , cursor{0, 0}
+    {}
+
+    ~Text_atlas() { al_destroy_bitmap(bitmap); }
+
+    Text_atlas(const Text_atlas &) = delete;
+    Text_atlas &operator=(const Text_atlas &) = delete;
+
+    Rectangle Region(const std::string &text);
+
+    void Draw(const Rectangle &region, const Vector &origin, const ALLEGRO_COLOR &color) const
+    {
+        al_draw_tinted_bitmap_region(bitmap,
+                                     color,
+                                     region.Origin().X(),
+                                     region.Origin().Y(),
+                                     region.Width(),
+                                     region.Height(),
+                                     origin.X(),
+                                     origin.Y(),
+                                     0);
+    }
+
+private:
+    static constexpr int padding = 1; // keeps neighbours out of a filtered region
+
+    void Reserve(int width, int height);
+
+    const ALLEGRO_FONT *const font;
+    ALLEGRO_BITMAP *bitmap;
+    Vector cursor; // where the next string goes, on the current shelf
+    std::unordered_map<std::string, Rectangle> regions;
+};
+
 class One_line_text
+// a string of the atlas, placed relative to the origin of the box that owns it
 {
 public:
-    // static void Font(const ALLEGRO_FONT* font) { font = font; }
-    // float Font_height() { return al_get_font_line_height(font); }
-    // static float font_width() { return al_get_font_line_height(font_); }
-
-    One_line_text(const Vector &origin,
-                  const std::string &text,
-                  const ALLEGRO_FONT *const font,
-                  const ALLEGRO_COLOR &text_color)
-        : text{text}
-        , // no validation for \n
-        font{font}
+    One_line_text(const Vector &offset, const Rectangle &region, const ALLEGRO_COLOR &text_color)
+        : offset{offset}
+        , region{region}
         , text_color{text_color}
-        , shape{origin,
-                Vector(
-                    // 8 * text.length(),
-                    al_get_text_width(font, &text.front()),
-                    al_get_font_line_height(font))}
     {}
 
-    void Draw() const
+    void Draw(const Text_atlas &atlas, const Vector &origin, const ALLEGRO_COLOR &color) const
     {
-        al_draw_text(font,
-                     text_color,
-                     shape.Origin().X(),
-                     shape.Origin().Y(),
-                     ALLEGRO_ALIGN_LEFT,
-                     &text.front());
+        atlas.Draw(region, origin + offset, color);
     }
 
-    bool Contain(const Vector &point) const { return shape.Contain(point); }
+    Rectangle Shape(const Vector &origin) const { return Rectangle(origin + offset, region.Size()); }
 
-    float Width() const { return shape.Width(); }
+    float Width() const { return region.Width(); }
 
-    const std::string &Text() const { return text; }
+    // the color on screen, mid fade or settled
+    ALLEGRO_COLOR Color() const { return tween::Animator::Instance().Color(highlight, text_color); }
+    const ALLEGRO_COLOR &Settled_color() const { return text_color; }
+    bool Fading() const { return tween::Animator::Instance().Running(highlight); }
 
-    void Make_active() { text_color = param::default_theme.active_text_color; }
-    void Make_passive() { text_color = param::default_theme.passive_text_color; }
-    const Vector &Origin() const { return shape.Origin(); }
-    void Translate(const Vector &displacement) { shape.Translate(displacement); }
+    void Make_active() { Fade_to(param::default_theme.active_text_color); }
+    void Make_passive() { Fade_to(param::default_theme.passive_text_color); }
 
 private:
-    std::string text;
-    const ALLEGRO_FONT *const font;
-    ALLEGRO_COLOR text_color;
-    Rectangle shape;
+    void Fade_to(const ALLEGRO_COLOR &color)
+    // from the color on screen, which is mid fade when the selection moves quickly
+    {
+        tween::Animator &animator = tween::Animator::Instance();
+        ALLEGRO_COLOR shown = animator.Color(highlight, text_color);
+
+        animator.Stop(highlight);
+        highlight = animator.Start(shown, color, param::highlight_seconds);
+        text_color = color;
+    }
+
+    Vector offset;
+    Rectangle region; // in the atlas
+    ALLEGRO_COLOR text_color; // once the fade is over
+    tween::Handle highlight;
 };
 
 class Dialog_box
+// retained: entries keep their place relative to the box, so adding one moves nothing
+// else, and the box with every settled text is rendered to one bitmap when something
+// changes. A frame is one blit of it, plus the entries whose highlight is fading.
 {
 public:
+    ~Dialog_box() { al_destroy_bitmap(panel); }
+
+    Dialog_box(const Dialog_box &) = delete;
+    Dialog_box &operator=(const Dialog_box &) = delete;
+
     void Update_selected_choice(int allegro_keyboard_event_keycode)
     {
         if (allegro_keyboard_event_keycode != ALLEGRO_KEY_DOWN
@@ -81,13 +129,14 @@ public:
             selected_choice_index = choices.size() - 1;
 
         choices.at(selected_choice_index).Make_active();
+        panel_dirty = true;
     }
 
     void Update_selected_choice(const Vector &mouse_coordinate)
     {
         std::vector<One_line_text>::iterator selected_choice_iterator
             = find_if(choices.begin(), choices.end(), [&](const One_line_text &choice) {
-                  return choice.Contain(mouse_coordinate);
+                  return choice.Shape(shape.Origin()).Contain(mouse_coordinate);
               });
 
         if (selected_choice_iterator != choices.end()
@@ -95,19 +144,30 @@ public:
             choices.at(selected_choice_index).Make_passive();
             selected_choice_index = selected_choice_iterator - choices.begin();
             choices.at(selected_choice_index).Make_active();
+            panel_dirty = true;
         }
     }
 
     void Draw() const
     {
-        shape.Draw(color);
-        shape.Draw(line_color, line_width);
+        if (panel_dirty)
+            Render_panel();
 
-        for (const One_line_text &message : messages)
-            message.Draw();
+        if (!panel)
+            return;
 
-        for (const One_line_text &choice : choices)
-            choice.Draw();
+        al_draw_bitmap(panel, shape.Origin().X() - margin, shape.Origin().Y() - margin, 0);
+
+        // the panel holds the settled color, a fading entry covers it with its own
+        for (const std::vector<One_line_text> *entries : {&messages, &choices}) {
+            for (const One_line_text &entry : *entries) {
+                if (!entry.Fading())
+                    continue;
+
+                entry.Shape(shape.Origin()).Draw(color);
+                entry.Draw(atlas, shape.Origin(), entry.Color());
+            }
+        }
     }
 
     int Selected_choice_index() const { return selected_choice_index; }
@@ -116,17 +176,27 @@ public:
                      const ALLEGRO_COLOR &text_color = param::default_theme.passive_text_color,
                      const ALLEGRO_COLOR &background_color = param::default_theme.background_color)
     {
-        if (Messages_width() + (text.length() + 1) * monospaced_font_width > shape.Width())
-            shape.Width(Messages_width() + (text.length() + 1) * monospaced_font_width);
+        if (messages_width + (text.length() + 1) * monospaced_font_width > shape.Width())
+            shape.Width(messages_width + (text.length() + 1) * monospaced_font_width);
 
         shape.Origin(center - shape.Size() * 0.5f);
 
-        Update_messages_origin();
+        Rectangle region = atlas.Region(text);
 
-        messages.emplace_back(Message_origin(), text, monospaced_font, text_color);
+        messages.emplace_back(Vector(messages_width + monospaced_font_width * 0.5f,
+                                     monospaced_font_height * 0.5f),
+                              region,
+                              text_color);
+        messages_width += region.Width();
+        panel_dirty = true;
     }
 
-    void Erase_message() { messages.clear(); }
+    void Erase_message()
+    {
+        messages.clear();
+        messages_width = 0;
+        panel_dirty = true;
+    }
 
 protected:
     Dialog_box(
@@ -136,7 +206,7 @@ protected:
         const ALLEGRO_COLOR& line_color = param::default_theme.line_color
     ):
         center{center},
-        monospaced_font{monospaced_font},
+        atlas{monospaced_font},
         monospaced_font_height{al_get_font_line_height(monospaced_font)},
         monospaced_font_width{al_get_text_width(monospaced_font, "a")},
         shape{
@@ -146,7 +216,11 @@ protected:
         color{color},
         line_color{line_color},
         line_width{param::line_width},
-        selected_choice_index{0}
+        margin{static_cast<int>(std::ceil(param::line_width))},
+        messages_width{0},
+        selected_choice_index{0},
+        panel{nullptr},
+        panel_dirty{true}
     {}
 
     void Add_choice(const std::string &text,
@@ -160,74 +234,140 @@ protected:
 
         shape.Origin(center - shape.Size() * 0.5);
 
-        Update_choices_origin();
-
-        choices.emplace_back(Choice_origin(), text, monospaced_font, text_color);
+        choices.emplace_back(Vector(monospaced_font_width * 0.5f,
+                                    (2 + choices.size() * 1.5f) * monospaced_font_height),
+                             atlas.Region(text),
+                             text_color);
 
         if (choices.size() == 1)
             choices.front().Make_active();
+
+        panel_dirty = true;
     }
 
 private:
-    float Messages_width() const
+    void Render_panel() const
+    // the box and every entry in its settled color, into a bitmap a border wider than it
     {
-        float sum = 0;
+        int width = static_cast<int>(std::ceil(shape.Width())) + 2 * margin;
+        int height = static_cast<int>(std::ceil(shape.Height())) + 2 * margin;
 
-        for (const One_line_text &message : messages)
-            sum += message.Width();
+        if (panel && (al_get_bitmap_width(panel) != width || al_get_bitmap_height(panel) != height)) {
+            al_destroy_bitmap(panel);
+            panel = nullptr;
+        }
 
-        return sum;
-    }
+        ALLEGRO_STATE state;
+        al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP);
 
-    Vector Message_origin() const
-    {
-        return shape.Origin()
-               + Vector(Messages_width() + monospaced_font_width * 0.5f,
-                        monospaced_font_height * 0.5f);
-    }
+        if (!panel)
+            panel = al_create_bitmap(width, height);
 
-    void Update_messages_origin()
-    {
-        if (messages.empty())
+        if (!panel) {
+            al_restore_state(&state);
             return;
+        }
 
-        Vector displacement = shape.Origin() - messages.front().Origin();
+        al_set_target_bitmap(panel);
+        al_clear_to_color(al_map_rgba(0, 0, 0, 0));
 
-        std::for_each(messages.begin(), messages.end(), [&](One_line_text &message) {
-            message.Translate(displacement);
-        });
-    }
+        Vector origin = Vector(margin, margin);
+        Rectangle box = Rectangle(origin, shape.Size());
 
-    void Update_choices_origin()
-    {
-        if (choices.empty())
-            return;
+        box.Draw(color);
+        box.Draw(line_color, line_width);
 
-        Vector displacement = shape.Origin()
-                              + Vector(monospaced_font_width * 0.5f, monospaced_font_height * 2)
-                              - choices.front().Origin();
+        al_hold_bitmap_drawing(true);
 
-        std::for_each(choices.begin(), choices.end(), [&](One_line_text &choice) {
-            choice.Translate(displacement);
-        });
-    }
+        for (const One_line_text &message : messages)
+            message.Draw(atlas, origin, message.Settled_color());
 
-    Vector Choice_origin() const
-    {
-        return shape.Origin()
-               + Vector(monospaced_font_width * 0.5f,
-                        (2 + choices.size() * 1.5) * monospaced_font_height);
+        for (const One_line_text &choice : choices)
+            choice.Draw(atlas, origin, choice.Settled_color());
+
+        al_hold_bitmap_drawing(false);
+        al_restore_state(&state);
+
+        panel_dirty = false;
     }
 
     const Vector center;
-    const ALLEGRO_FONT *const monospaced_font;
+    Text_atlas atlas;
     int monospaced_font_height;
     int monospaced_font_width;
     Rectangle shape;
     ALLEGRO_COLOR color;
     ALLEGRO_COLOR line_color;
     float line_width;
+    int margin; // room for the half of the border outside shape
+    float messages_width;
     std::vector<One_line_text> messages;
     std::vector<One_line_text> choices;
     int selected_choice_index;
+
+    mutable ALLEGRO_BITMAP *panel;
+    mutable bool panel_dirty;
 };
+
+Rectangle Text_atlas::Region(const std::string &text)
+// added on first use, later uses of the same string share its region
+{
+    auto found = regions.find(text);
+
+    if (found != regions.end())
+        return found->second;
+
+    int width = al_get_text_width(font, text.c_str());
+    int height = al_get_font_line_height(font);
+
+    if (bitmap && cursor.X() > 0 && cursor.X() + width > al_get_bitmap_width(bitmap))
+        cursor = Vector(0, cursor.Y() + height + padding);
+
+    Reserve(static_cast<int>(cursor.X()) + width, static_cast<int>(cursor.Y()) + height);
+
+    ALLEGRO_STATE state;
+    al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP);
+    al_set_target_bitmap(bitmap);
+    // full white, so the tint is the color on screen
+    al_draw_text(font, al_map_rgb_f(1, 1, 1), cursor.X(), cursor.Y(), ALLEGRO_ALIGN_LEFT, text.c_str());
+    al_restore_state(&state);
+
+    Rectangle region = Rectangle(cursor, Vector(width, height));
+    cursor += Vector(width + padding, 0);
+    regions.emplace(text, region);
+
+    return region;
+}
+
+void Text_atlas::Reserve(int width, int height)
+// doubles the bitmap until it holds width x height, copying what was drawn so far
+{
+    int old_width = bitmap ? al_get_bitmap_width(bitmap) : 0;
+    int old_height = bitmap ? al_get_bitmap_height(bitmap) : 0;
+    int new_width = std::max(old_width, 256);
+    int new_height = std::max(old_height, 64);
+
+    while (new_width < width)
+        new_width *= 2;
+
+    while (new_height < height)
+        new_height *= 2;
+
+    if (new_width == old_width && new_height == old_height)
+        return;
+
+    ALLEGRO_STATE state;
+    al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP);
+
+    ALLEGRO_BITMAP *grown = al_create_bitmap(new_width, new_height);
+    al_set_target_bitmap(grown);
+    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+
+    if (bitmap) {
+        al_draw_bitmap(bitmap, 0, 0, 0);
+        al_destroy_bitmap(bitmap);
+    }
+
+    al_restore_state(&state);
+    bitmap = grown;
+}
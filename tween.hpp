@@ -0,0 +1,236 @@
+#include <allegro5/color.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+#pragma once
+
+// Color tweens driven by elapsed time rather than by ticks.
+//
+// Every running tween is a column in a structure of arrays, so Update is one pass over
+// all of them, four at a time with SSE where there is SSE; the easing is a cubic
+// polynomial per tween instead of a switch, to keep that pass branch free.
+// Finished tweens are compacted away at the end of the same Update. Owners keep a
+// Handle, which stays safe to ask about after its tween is gone.
+
+namespace tween {
+enum class Easing { linear, ease_out, ease_in_out };
+
+struct Handle
+{
+    std::uint32_t slot = UINT32_MAX;
+    std::uint32_t generation = 0;
+};
+
+class Animator
+{
+public:
+    Handle Start(const ALLEGRO_COLOR &from,
+                 const ALLEGRO_COLOR &to,
+                 float seconds,
+                 Easing easing = Easing::ease_out);
+    void Stop(Handle handle);
+    void Update(float seconds);
+
+    bool Running(Handle handle) const { return Index(handle) != npos; }
+    ALLEGRO_COLOR Color(Handle handle, const ALLEGRO_COLOR &when_finished) const;
+    std::size_t Size() const { return progress.size(); }
+
+    static Animator &Instance()
+    // the one the game and its UI share, from the thread that draws
+    {
+        static Animator animator;
+        return animator;
+    }
+
+private:
+    static constexpr std::size_t npos = SIZE_MAX;
+
+    std::size_t Index(Handle handle) const;
+    void Retire();
+
+    // one entry per running tween
+    std::vector<float> progress; // 0 to 1
+    std::vector<float> rate;     // progress per second
+    std::vector<float> ease_1;   // eased = ease_1 t + ease_2 t^2 + ease_3 t^3
+    std::vector<float> ease_2;
+    std::vector<float> ease_3;
+    std::vector<float> from[4]; // r, g, b, a
+    std::vector<float> delta[4];
+    std::vector<float> current[4];
+    std::vector<std::uint32_t> slot_of;
+
+    // one entry per handle slot, reused once its tween retires
+    std::vector<std::uint32_t> index_of_slot;
+    std::vector<std::uint32_t> generation_of_slot;
+    std::vector<std::uint32_t> free_slots;
+};
+}; // namespace tween
+
+tween::Handle tween::Animator::Start(const ALLEGRO_COLOR &from,
+                                     const ALLEGRO_COLOR &to,
+                                     float seconds,
+                                     Easing easing)
+{
+    std::uint32_t slot;
+
+    if (free_slots.empty()) {
+        slot = static_cast<std::uint32_t>(index_of_slot.size());
+        index_of_slot.push_back(0);
+        generation_of_slot.push_back(0);
+    } else {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    }
+
+    index_of_slot[slot] = static_cast<std::uint32_t>(progress.size());
+
+    // t, 3t - 3t^2 + t^3 = 1 - (1 - t)^3, and 3t^2 - 2t^3 (smoothstep)
+    const float coefficients[3][3] = {{1, 0, 0}, {3, -3, 1}, {0, 3, -2}};
+    const float *ease = coefficients[static_cast<int>(easing)];
+
+    progress.push_back(0);
+    rate.push_back(seconds > 0 ? 1 / seconds : 1e9f);
+    ease_1.push_back(ease[0]);
+    ease_2.push_back(ease[1]);
+    ease_3.push_back(ease[2]);
+
+    const float start[4] = {from.r, from.g, from.b, from.a};
+    const float end[4] = {to.r, to.g, to.b, to.a};
+
+    for (int c = 0; c < 4; c++) {
+        this->from[c].push_back(start[c]);
+        delta[c].push_back(end[c] - start[c]);
+        current[c].push_back(start[c]);
+    }
+
+    slot_of.push_back(slot);
+
+    return {slot, generation_of_slot[slot]};
+}
+
+void tween::Animator::Stop(Handle handle)
+// the tween retires on the next Update, Color already answers when_finished
+{
+    std::size_t i = Index(handle);
+
+    if (i != npos)
+        progress[i] = 1;
+}
+
+void tween::Animator::Update(float seconds)
+{
+    const std::size_t count = progress.size();
+    float *t = progress.data();
+    const float *speed = rate.data();
+    const float *a = ease_1.data();
+    const float *b = ease_2.data();
+    const float *c = ease_3.data();
+    std::size_t i = 0;
+
+#if defined(__SSE__) || defined(_M_X64)
+    const __m128 elapsed = _mm_set1_ps(seconds);
+    const __m128 one = _mm_set1_ps(1);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 t4 = _mm_min_ps(_mm_add_ps(_mm_loadu_ps(t + i),
+                                          _mm_mul_ps(elapsed, _mm_loadu_ps(speed + i))),
+                               one);
+        _mm_storeu_ps(t + i, t4);
+
+        __m128 eased = _mm_add_ps(_mm_loadu_ps(b + i), _mm_mul_ps(t4, _mm_loadu_ps(c + i)));
+        eased = _mm_mul_ps(t4, _mm_add_ps(_mm_loadu_ps(a + i), _mm_mul_ps(t4, eased)));
+
+        for (int channel = 0; channel < 4; channel++) {
+            __m128 value = _mm_add_ps(_mm_loadu_ps(from[channel].data() + i),
+                                      _mm_mul_ps(_mm_loadu_ps(delta[channel].data() + i), eased));
+            _mm_storeu_ps(current[channel].data() + i, value);
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        t[i] = std::min(t[i] + seconds * speed[i], 1.f);
+
+        float eased = t[i] * (a[i] + t[i] * (b[i] + t[i] * c[i]));
+
+        for (int channel = 0; channel < 4; channel++)
+            current[channel][i] = from[channel][i] + delta[channel][i] * eased;
+    }
+
+    Retire();
+}
+
+ALLEGRO_COLOR tween::Animator::Color(Handle handle, const ALLEGRO_COLOR &when_finished) const
+{
+    std::size_t i = Index(handle);
+
+    if (i == npos)
+        return when_finished;
+
+    return {current[0][i], current[1][i], current[2][i], current[3][i]};
+}
+
+std::size_t tween::Animator::Index(Handle handle) const
+// npos once the tween has finished
+{
+    if (handle.slot >= index_of_slot.size() || generation_of_slot[handle.slot] != handle.generation)
+        return npos;
+
+    std::size_t i = index_of_slot[handle.slot];
+
+    return progress[i] < 1 ? i : npos;
+}
+
+void tween::Animator::Retire()
+// one compaction pass for every finished tween, keeping the rest in order
+{
+    const std::size_t count = progress.size();
+    std::size_t kept = 0;
+
+    for (std::size_t i = 0; i < count; i++) {
+        std::uint32_t slot = slot_of[i];
+
+        if (progress[i] >= 1) {
+            generation_of_slot[slot]++;
+            free_slots.push_back(slot);
+            continue;
+        }
+
+        if (kept != i) {
+            progress[kept] = progress[i];
+            rate[kept] = rate[i];
+            ease_1[kept] = ease_1[i];
+            ease_2[kept] = ease_2[i];
+            ease_3[kept] = ease_3[i];
+
+            for (int c = 0; c < 4; c++) {
+                from[c][kept] = from[c][i];
+                delta[c][kept] = delta[c][i];
+                current[c][kept] = current[c][i];
+            }
+
+            slot_of[kept] = slot;
+            index_of_slot[slot] = static_cast<std::uint32_t>(kept);
+        }
+
+        kept++;
+    }
+
+    if (kept == count)
+        return;
+
+    for (std::vector<float> *column : {&progress, &rate, &ease_1, &ease_2, &ease_3})
+        column->resize(kept);
+
+    for (int c = 0; c < 4; c++) {
+        from[c].resize(kept);
+        delta[c].resize(kept);
+        current[c].resize(kept);
+    }
+
+    slot_of.resize(kept);
+}